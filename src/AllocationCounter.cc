@@ -0,0 +1,32 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <SDL2/SDL.h>
+
+#include "AllocationCounter.hh"
+
+static std::atomic<Uint64> allocationCount(0);
+
+Uint64 getAllocationCount() {
+	return allocationCount.load(std::memory_order_relaxed);
+}
+
+// Replacements for the global allocation functions, new[] and the nothrow
+// forms forward to these by default
+
+void* operator new(size_t size) {
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	void* ptr = malloc(size == 0 ? 1 : size);
+	if (ptr == NULL) {
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+	free(ptr);
+}
+
+void operator delete(void* ptr, size_t size) noexcept {
+	free(ptr);
+}
@@ -0,0 +1,15 @@
+#ifndef ALLOCATION_COUNTER_HH
+#define ALLOCATION_COUNTER_HH
+
+#include <SDL2/SDL.h>
+
+/**
+ * Hook for counting heap allocations
+ * Programs linked with AllocationCounter.o replace the global operator new
+ * so that every allocation made through new (including those made by
+ * standard containers) is counted. Other programs are not affected.
+ * @return Number of allocations made since the program started
+ */
+Uint64 getAllocationCount();
+
+#endif
@@ -0,0 +1,1103 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <sstream>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "DifferentialFuzzer.hh"
+#include "FixedSnakeGame.hh"
+#include "FrameExporter.hh"
+#include "GameServer.hh"
+#include "GlyphCache.hh"
+#include "GridRasterizer.hh"
+#include "Replay.hh"
+#include "ReplayArchive.hh"
+#include "Rollout.hh"
+#include "Search.hh"
+#include "SnakeGame.hh"
+#include "SessionScheduler.hh"
+#include "SnakeWorld.hh"
+#include "TextDisplay.hh"
+#include "Trace.hh"
+#include "TranspositionTable.hh"
+
+#define ARCHIVE_MAX_REPLAYS (1000000)
+#define ARCHIVE_MAX_SCORE (400)
+#define ARCHIVE_PATH ("bench-archive.bin")
+#define ARCHIVE_QUERIES (10000)
+#define ARCHIVE_RANGE (10)
+#define ARCHIVE_TOP (100)
+#define BENCH_APPLES (3)
+#define BENCH_GRID_DIMENSION (20)
+#define BENCH_SEED (12345)
+#define CLONE_ITERATIONS (1000000)
+#define EXPORT_DIMENSION (400)
+#define EXPORT_PATH ("bench-export")
+#define EXPORT_TICKS (200)
+#define FONT_PATH ("fonts/BebasNeue-Regular.ttf")
+#define FONT_SIZE (25)
+#define FUZZ_CASES (50000)
+#define GLYPH_CACHE_PATH ("bench-glyphs.bin")
+#define HUGE_APPLES (1000)
+#define HUGE_DIMENSION (100000)
+#define HUGE_INITS (100)
+#define HUGE_MOVES (1000000)
+#define INIT_CELLS (10000000)
+#define COMPARE_FLAG ("--compare")
+#define JSON_FLAG ("--json")
+#define FILTER_FLAG ("--filter")
+#define LOAD_TEXT_ITERATIONS (2000)
+#define MAX_LENGTH (10000)
+#define MOVE_APPLE_DIVISOR (256)
+#define MOVE_BATCHES (100)
+#define MOVE_BATCH_SIZE (10000)
+#define RENDER_DIMENSION (800)
+#define RENDER_FRAMES (200)
+#define ROLLOUT_DEPTH (100)
+#define ROLLOUT_EVALUATIONS (20)
+#define ROLLOUTS_PER_MOVE (256)
+#define SEARCH_DEPTH (8)
+#define STARTUP_ITERATIONS (20)
+#define STARTUP_LINES (20)
+#define SERVER_CLIENTS (256)
+#define SERVER_DRAIN_TICKS (100)
+#define SERVER_PATH ("bench-server.sock")
+#define SERVER_TICKS (2000)
+#define SESSION_MAX_COUNT (10000)
+#define SESSION_MS (2000)
+#define SESSION_THREADS (4)
+#define SESSION_WARMUP_MS (500)
+#define STEP_LOOP_TICKS (5000000)
+#define SEARCH_MOVES (20)
+#define TABLE_LOG2_ENTRIES (20)
+#define TRACE_SPANS (1000000)
+#define WARMUP_MOVES (150)
+#define WORLD_DIMENSION (1024)
+#define WORLD_MAX_SNAKES (10000)
+#define WORLD_TICKS (200)
+#define WARMUP_ROLLOUTS (16)
+
+// Grid dimensions the engine and renderer are measured at
+const int GRID_DIMENSIONS[] = {20, 100, 1000};
+
+// Settings the replays in archives are spread over
+const Uint32 ARCHIVE_DIMENSIONS[] = {10, 20, 30, 40};
+const Uint32 ARCHIVE_APPLES[] = {1, 3, 5};
+const Uint64 ARCHIVE_DELAYS[] = {100, 150};
+const Uint64 ARCHIVE_ACCELERATIONS[] = {0, 5};
+
+// Time delays of the sessions run together, each gets its own tick rate
+const Uint64 SESSION_DELAYS[] = {20, 30, 50};
+
+// Text as long as the longest line the menu loads
+const std::string BENCH_TEXT = "Acceleration of the snake (in ms / apple "
+															 "acquired): 150";
+
+// One measurement, the name is what was measured and the parameters are the
+// space separated settings it was measured with
+struct BenchResult {
+	std::string name;
+	std::string params;
+	double value;
+	std::string unit;
+};
+
+// Every measurement in the order it was made
+std::vector<BenchResult> results;
+
+// Only benchmarks whose name contains this are run
+std::string filter;
+
+// Whether a benchmark was asked for on the command line
+bool selected(const std::string& name) {
+	return name.find(filter) != std::string::npos;
+}
+
+/**
+ * Keep a measurement to be written out once every benchmark has run, and
+ * show it on stderr so long runs show progress
+ * @param name What was measured
+ * @param params Settings the measurement was made with
+ * @param value The measurement
+ * @param unit Unit of the measurement
+ */
+void report(const std::string& name, const std::string& params, double value,
+						const std::string& unit) {
+	results.push_back({name, params, value, unit});
+	std::cerr << name << ' ' << params << ": " << value << ' ' << unit << '\n';
+}
+
+// Write every result as CSV with a header row
+void writeCSV(std::ostream& out) {
+	out << "name,params,value,unit\n";
+	for (const BenchResult& result : results) {
+		out << result.name << ',' << result.params << ',' << result.value << ','
+				<< result.unit << '\n';
+	}
+}
+
+// Write every result as a JSON array of objects
+void writeJSON(std::ostream& out) {
+	out << "[\n";
+	for (size_t i = 0; i < results.size(); i++) {
+		const BenchResult& result = results[i];
+		out << "  {\"name\": \"" << result.name << "\", \"params\": \""
+				<< result.params << "\", \"value\": " << result.value
+				<< ", \"unit\": \"" << result.unit << "\"}"
+				<< (i + 1 < results.size() ? ",\n" : "\n");
+	}
+	out << "]\n";
+}
+
+// Seconds elapsed since the given performance counter value
+double secondsSince(Uint64 start) {
+	return (double) (SDL_GetPerformanceCounter() - start) /
+				 SDL_GetPerformanceFrequency();
+}
+
+/**
+ * Play a game with a small rollout agent to get a snake of some length
+ * @param game Game that will be initialized and played
+ * @param moves Number of moves to play
+ */
+void warmUp(SnakeGame* game, int moves) {
+	RolloutEvaluator agent(1, WARMUP_ROLLOUTS, ROLLOUT_DEPTH);
+	game->init(BENCH_GRID_DIMENSION, BENCH_GRID_DIMENSION, BENCH_APPLES,
+						 BENCH_SEED);
+	for (int i = 0; i < moves && game->isPlaying(); i++) {
+		game->setDirection(agent.evaluate(*game, BENCH_SEED + i));
+		game->move();
+	}
+}
+
+// Measure how many clones into preallocated storage can be made per second
+void benchClone() {
+	SnakeGame game;
+	warmUp(&game, WARMUP_MOVES);
+	SnakeGame copy;
+	copy.reserve(BENCH_GRID_DIMENSION, BENCH_GRID_DIMENSION);
+
+	Uint64 start = SDL_GetPerformanceCounter();
+	for (int i = 0; i < CLONE_ITERATIONS; i++) {
+		game.clone(copy);
+	}
+	double elapsed = secondsSince(start);
+	std::stringstream params;
+	params << "rows=" << BENCH_GRID_DIMENSION << " cols=" << BENCH_GRID_DIMENSION
+				 << " length=" << game.getScore();
+	report("clone", params.str(), CLONE_ITERATIONS / elapsed, "clones/s");
+}
+
+// Measure how many playouts the rollout evaluator can run per second
+void benchRollout(RolloutPolicy policy, int nThreads) {
+	SnakeGame game;
+	warmUp(&game, WARMUP_MOVES);
+	RolloutEvaluator evaluator(nThreads, ROLLOUTS_PER_MOVE, ROLLOUT_DEPTH, policy);
+
+	Uint64 start = SDL_GetPerformanceCounter();
+	for (int i = 0; i < ROLLOUT_EVALUATIONS; i++) {
+		evaluator.evaluate(game, BENCH_SEED + i);
+	}
+	double elapsed = secondsSince(start);
+	std::stringstream params;
+	params << "policy=" << (policy == RANDOM_POLICY ? "random" : "heuristic")
+				 << " threads=" << nThreads;
+	report("rollout", params.str(), evaluator.getRolloutCount() / elapsed,
+				 "rollouts/s");
+}
+
+/**
+ * Measure how many positions a depth-limited search expands per second
+ * @param useTable Whether the search skips positions with a transposition table
+ */
+void benchSearch(bool useTable) {
+	SnakeGame game;
+	game.init(BENCH_GRID_DIMENSION, BENCH_GRID_DIMENSION, BENCH_APPLES,
+						BENCH_SEED);
+	TranspositionTable table(TABLE_LOG2_ENTRIES);
+	SearchAgent agent(SEARCH_DEPTH, useTable ? &table : NULL);
+
+	Uint64 start = SDL_GetPerformanceCounter();
+	for (int i = 0; i < SEARCH_MOVES && game.isPlaying(); i++) {
+		game.setDirection(agent.search(game));
+		game.move();
+	}
+	double elapsed = secondsSince(start);
+	std::stringstream params;
+	params << "depth=" << SEARCH_DEPTH << " table=" << useTable;
+	report("search", params.str(), agent.getNodeCount() / elapsed, "nodes/s");
+	report("search", params.str(), agent.getNodeCount(), "nodes");
+	report("search", params.str(), agent.getTableHits(), "table hits");
+	report("search", params.str(), elapsed * 1000 / SEARCH_MOVES, "ms/move");
+}
+
+/**
+ * Measure how many ticks per second a world shared by many snakes runs at
+ * @param numSnakes Number of snakes spawned in the world
+ * @param nThreads Number of threads advancing the world
+ */
+void benchWorld(int numSnakes, int nThreads) {
+	SnakeWorld world(WORLD_DIMENSION, WORLD_DIMENSION, nThreads);
+	world.init(numSnakes, numSnakes, BENCH_SEED);
+
+	Uint64 start = SDL_GetPerformanceCounter();
+	for (int i = 0; i < WORLD_TICKS; i++) {
+		world.steer();
+		world.tick();
+	}
+	double elapsed = secondsSince(start);
+	std::stringstream params;
+	params << "rows=" << WORLD_DIMENSION << " cols=" << WORLD_DIMENSION
+				 << " snakes=" << numSnakes << " threads=" << nThreads;
+	report("world", params.str(), WORLD_TICKS / elapsed, "ticks/s");
+	report("world", params.str(), world.getAliveCount(), "alive");
+}
+
+/**
+ * Measure starting and playing a game on a board far too large to store
+ * every cell. Boards this large are split into lazily allocated chunks.
+ */
+void benchHugeBoard() {
+	SnakeGame game;
+	Uint64 start = SDL_GetPerformanceCounter();
+	for (int i = 0; i < HUGE_INITS; i++) {
+		game.init(HUGE_DIMENSION, HUGE_DIMENSION, HUGE_APPLES, BENCH_SEED + i);
+	}
+	double initElapsed = secondsSince(start);
+
+	// Walk in a square spiral so the snake keeps crossing into new chunks
+	Direction turns[] = {RIGHT, DOWN, LEFT, UP};
+	int leg = 1;
+	int turn = 0;
+	int moves = 0;
+	start = SDL_GetPerformanceCounter();
+	while (moves < HUGE_MOVES && game.isPlaying()) {
+		game.setDirection(turns[turn % NONE]);
+		for (int i = 0; i < leg && moves < HUGE_MOVES && game.move(); i++) {
+			moves++;
+		}
+		turn++;
+		leg += turn % 2 == 0 ? 2 : 0;
+	}
+	double moveElapsed = secondsSince(start);
+	std::stringstream params;
+	params << "rows=" << HUGE_DIMENSION << " cols=" << HUGE_DIMENSION
+				 << " apples=" << HUGE_APPLES;
+	report("huge init", params.str(), initElapsed * 1e6 / HUGE_INITS, "us/op");
+	report("huge move", params.str(), moves / moveElapsed, "moves/s");
+}
+
+/**
+ * Play games back to back for a number of ticks, steering away from walls
+ * and the body, and restarting whenever a game ends
+ * @param game Any engine with the SnakeGame interface
+ * @param start Starts a new game with the given seed
+ * @return Number of games played
+ */
+template <typename Game, typename Start>
+int stepLoop(Game& game, Start start) {
+	Uint64 rng = BENCH_SEED;
+	int games = 1;
+	start(game, rng);
+	for (int tick = 0; tick < STEP_LOOP_TICKS; tick++) {
+		std::pair<int, int> head = game.getHead();
+		rng = rng * 6364136223846793005ULL + 1442695040888963407ULL;
+		int first = rng >> 62;
+		for (int i = 0; i < NONE; i++) {
+			Direction d = (Direction) ((first + i) % NONE);
+			int r = head.first + (d == DOWN) - (d == UP);
+			int c = head.second + (d == RIGHT) - (d == LEFT);
+			if (r >= 0 && c >= 0 && r < game.getRows() && c < game.getCols() &&
+					game.getCell(r, c) != BODY && game.setDirection(d)) {
+				break;
+			}
+		}
+		if (!game.move()) {
+			start(game, rng);
+			games++;
+		}
+	}
+	return games;
+}
+
+/**
+ * Compare the engine with its size fixed at compile time to the dynamically
+ * sized engine on the same step loop
+ */
+template <int Rows, int Cols>
+void benchFixed() {
+	FixedSnakeGame<Rows, Cols> fixed;
+	Uint64 start = SDL_GetPerformanceCounter();
+	int games = stepLoop(fixed, [](FixedSnakeGame<Rows, Cols>& game, Uint64 seed) {
+		game.init(BENCH_APPLES, seed);
+	});
+	double fixedElapsed = secondsSince(start);
+
+	SnakeGame dynamic;
+	start = SDL_GetPerformanceCounter();
+	stepLoop(dynamic, [](SnakeGame& game, Uint64 seed) {
+		game.init(Rows, Cols, BENCH_APPLES, seed);
+	});
+	double dynamicElapsed = secondsSince(start);
+	std::stringstream params;
+	params << "rows=" << Rows << " cols=" << Cols << " games=" << games;
+	report("step loop fixed", params.str(), STEP_LOOP_TICKS / fixedElapsed,
+				 "ticks/s");
+	report("step loop dynamic", params.str(), STEP_LOOP_TICKS / dynamicElapsed,
+				 "ticks/s");
+}
+
+/**
+ * Read results written as CSV by an earlier run
+ * @param path Path of the CSV file
+ * @param fileResults Vector the results are added to
+ * @return Whether the file could be read
+ */
+bool readCSV(const std::string& path, std::vector<BenchResult>* fileResults) {
+	std::ifstream file(path);
+	std::string line;
+	if (!std::getline(file, line)) { // Header
+		return false;
+	}
+	while (std::getline(file, line)) {
+		std::stringstream fields(line);
+		BenchResult result;
+		std::string value;
+		if (std::getline(fields, result.name, ',') &&
+				std::getline(fields, result.params, ',') &&
+				std::getline(fields, value, ',') &&
+				std::getline(fields, result.unit)) {
+			result.value = atof(value.c_str());
+			fileResults->push_back(result);
+		}
+	}
+	return true;
+}
+
+/**
+ * How many times faster a result is than a baseline, higher is better
+ * @param base The baseline result
+ * @param other The result compared to it
+ * @return The speedup, or 0 when the unit is not a rate or a time per
+ 					 operation
+ */
+double speedup(const BenchResult& base, const BenchResult& other) {
+	const std::string& unit = base.unit;
+	if (unit.find('/') == std::string::npos || base.value == 0 ||
+			other.value == 0) {
+		return 0;
+	}
+	bool perSecond = unit.size() >= 2 &&
+									 unit.compare(unit.size() - 2, 2, "/s") == 0;
+	return perSecond ? other.value / base.value : base.value / other.value;
+}
+
+/**
+ * Print results of runs side by side as CSV with the speedup of each run
+ * over the first, to see what a change or a kind of build gained
+ * @param paths Paths of CSV files written by earlier runs
+ * @return Whether every file could be read
+ */
+bool compare(const std::vector<std::string>& paths) {
+	std::vector<std::vector<BenchResult>> runs(paths.size());
+	for (size_t i = 0; i < paths.size(); i++) {
+		if (!readCSV(paths[i], &runs[i])) {
+			std::cerr << "Unable to read " << paths[i] << '\n';
+			return false;
+		}
+	}
+
+	std::cout << "name,params,unit";
+	for (const std::string& path : paths) {
+		std::cout << ',' << path;
+	}
+	for (size_t i = 1; i < paths.size(); i++) {
+		std::cout << ',' << paths[i] << " speedup";
+	}
+	std::cout << '\n';
+	for (const BenchResult& base : runs[0]) {
+		std::vector<const BenchResult*> matches;
+		for (size_t i = 1; i < runs.size(); i++) {
+			const BenchResult* match = NULL;
+			for (const BenchResult& other : runs[i]) {
+				if (other.name == base.name && other.params == base.params &&
+						other.unit == base.unit) {
+					match = &other;
+					break;
+				}
+			}
+			matches.push_back(match);
+		}
+
+		std::cout << base.name << ',' << base.params << ',' << base.unit << ','
+							<< base.value;
+		for (const BenchResult* match : matches) {
+			std::cout << ',';
+			if (match != NULL) {
+				std::cout << match->value;
+			}
+		}
+		for (const BenchResult* match : matches) {
+			std::cout << ',';
+			if (match != NULL && speedup(base, *match) != 0) {
+				std::cout << speedup(base, *match);
+			}
+		}
+		std::cout << '\n';
+	}
+	return true;
+}
+
+/**
+ * Direction that keeps the head on a cycle through every cell of a grid with
+ * an even number of rows: along the rows in a zigzag that skips the first
+ * column, then back up the first column
+ * @param head Current location of the head
+ * @param rows Number of rows in the grid, must be even
+ * @param cols Number of columns in the grid
+ * @return Direction to move in next
+ */
+Direction cycleDirection(std::pair<int, int> head, int rows, int cols) {
+	int r = head.first;
+	int c = head.second;
+	if (c == 0) {
+		return r == 0 ? RIGHT : UP;
+	}
+	if (r % 2 == 0) {
+		return c < cols - 1 ? RIGHT : DOWN;
+	}
+	return c > 1 || r == rows - 1 ? LEFT : DOWN;
+}
+
+/**
+ * Play a game along the cycle through every cell until the snake is at least
+ * a given length, the snake can not collide with itself before filling the
+ * grid
+ * @param game Game that will be initialized and played
+ * @param rows Number of rows in the grid, must be even
+ * @param cols Number of columns in the grid
+ * @param apples Number of apples on the grid at once
+ * @param length Length the snake should reach
+ */
+void growAlongCycle(SnakeGame* game, int rows, int cols, int apples,
+										int length) {
+	game->init(rows, cols, apples, BENCH_SEED);
+	while (game->getScore() < (Uint64) length && game->isPlaying()) {
+		game->setDirection(cycleDirection(game->getHead(), rows, cols));
+		game->move();
+	}
+}
+
+/**
+ * Measure a single move of the snake at a given grid size and snake length
+ * Every batch of moves starts again from the same position so the length
+ * stays close to the one asked for, copying the position is not timed
+ * @param dimension Number of rows and columns in the grid
+ * @param length Length of the snake when each batch starts
+ */
+void benchMove(int dimension, int length) {
+	int apples = std::max(1, dimension * dimension / MOVE_APPLE_DIVISOR);
+	SnakeGame grown;
+	growAlongCycle(&grown, dimension, dimension, apples, length);
+	SnakeGame game;
+	game.reserve(dimension, dimension);
+
+	// The median batch is reported so other programs running have less effect
+	std::vector<Uint64> batchTicks;
+	for (int batch = 0; batch < MOVE_BATCHES; batch++) {
+		grown.clone(game);
+		Uint64 start = SDL_GetPerformanceCounter();
+		for (int i = 0; i < MOVE_BATCH_SIZE; i++) {
+			game.setDirection(cycleDirection(game.getHead(), dimension, dimension));
+			game.move();
+		}
+		batchTicks.push_back(SDL_GetPerformanceCounter() - start);
+	}
+	std::nth_element(batchTicks.begin(), batchTicks.begin() + MOVE_BATCHES / 2,
+									 batchTicks.end());
+	std::stringstream params;
+	params << "rows=" << dimension << " cols=" << dimension << " length="
+				 << grown.getScore() << " apples=" << apples;
+	report("move", params.str(), (double) batchTicks[MOVE_BATCHES / 2] /
+				 SDL_GetPerformanceFrequency() * 1e9 / MOVE_BATCH_SIZE, "ns/op");
+}
+
+/**
+ * Measure starting and resetting a game, and placing apples on it when many
+ * apples are asked for. Each size is repeated until about the same number of
+ * cells have been set up.
+ * @param dimension Number of rows and columns in the grid
+ */
+void benchInit(int dimension) {
+	int cells = dimension * dimension;
+	int repeats = std::max(1, INIT_CELLS / cells);
+	int manyApples = cells / 2;
+	SnakeGame game;
+
+	Uint64 initTicks = 0;
+	Uint64 resetTicks = 0;
+	for (int i = 0; i < repeats; i++) {
+		Uint64 start = SDL_GetPerformanceCounter();
+		game.init(dimension, dimension, 1, BENCH_SEED + i);
+		initTicks += SDL_GetPerformanceCounter() - start;
+		start = SDL_GetPerformanceCounter();
+		game.reset();
+		resetTicks += SDL_GetPerformanceCounter() - start;
+	}
+
+	Uint64 start = SDL_GetPerformanceCounter();
+	for (int i = 0; i < repeats; i++) {
+		game.init(dimension, dimension, manyApples, BENCH_SEED + i);
+	}
+	Uint64 manyTicks = SDL_GetPerformanceCounter() - start;
+
+	double nsPerTick = 1e9 / SDL_GetPerformanceFrequency();
+	std::stringstream params;
+	params << "rows=" << dimension << " cols=" << dimension;
+	report("init", params.str() + " apples=1",
+				 initTicks * nsPerTick / repeats / 1000, "us/op");
+	report("reset", params.str(), resetTicks * nsPerTick / repeats / 1000,
+				 "us/op");
+	// Every apple past the first costs one placeApple
+	params << " apples=" << manyApples;
+	report("placeApple", params.str(),
+				 ((double) manyTicks - initTicks) * nsPerTick / repeats /
+				 (manyApples - 1), "ns/op");
+}
+
+/**
+ * Measure drawing a frame of a game in progress with the renderer given
+ * Grids too large to fit in the window are drawn around the head
+ * @param renderer Renderer the game is drawn with
+ * @param dimension Number of rows and columns in the grid
+ * @param rasterizer Draws the cells into a framebuffer, NULL draws each cell
+										 through the renderer
+ */
+void benchRender(SDL_Renderer* renderer, int dimension,
+								 GridRasterizer* rasterizer) {
+	int length = std::min(MAX_LENGTH, dimension * dimension / 4);
+	SnakeGame game(renderer, NULL);
+	game.setRasterizer(rasterizer);
+	growAlongCycle(&game, dimension, dimension,
+								 std::max(1, dimension * dimension / MOVE_APPLE_DIVISOR),
+								 length);
+
+	Uint64 start = SDL_GetPerformanceCounter();
+	for (int i = 0; i < RENDER_FRAMES; i++) {
+		SDL_SetRenderDrawColor(renderer, 0xff, 0xff, 0xff, 0xff);
+		SDL_RenderClear(renderer);
+		game.render();
+	}
+	double elapsed = secondsSince(start);
+	std::stringstream params;
+	params << "rows=" << dimension << " cols=" << dimension << " length="
+				 << game.getScore() << " window=" << RENDER_DIMENSION;
+	if (rasterizer != NULL) {
+		params << " threads=" << rasterizer->getThreadCount();
+	}
+	report(rasterizer != NULL ? "render raster" : "render", params.str(),
+				 elapsed * 1e6 / RENDER_FRAMES, "us/op");
+}
+
+/**
+ * Measure turning a line of menu text into a texture
+ * @param renderer Renderer the texture is created for
+ * @param font Font the text is drawn in, NULL to copy it from the glyph cache
+ * @param glyphs The glyph cache, NULL to draw the text with the font
+ */
+void benchLoadText(SDL_Renderer* renderer, TTF_Font* font,
+									 const GlyphCache* glyphs) {
+	TextDisplay text(font, renderer, glyphs);
+	SDL_Color black = {0, 0, 0, 0xff};
+
+	Uint64 start = SDL_GetPerformanceCounter();
+	for (int i = 0; i < LOAD_TEXT_ITERATIONS; i++) {
+		text.loadText(BENCH_TEXT, black);
+	}
+	double elapsed = secondsSince(start);
+	text.free();
+	std::stringstream params;
+	params << "characters=" << BENCH_TEXT.size() << " size=" << FONT_SIZE;
+	report(font != NULL ? "loadText" : "loadText cached", params.str(),
+				 elapsed * 1e6 / LOAD_TEXT_ITERATIONS, "us/op");
+}
+
+/**
+ * Measure getting the menu text ready from a cold start, the way Main does:
+ * either opening the font and drawing every line with it, or opening the
+ * glyph cache and copying every line from it
+ * @param renderer Renderer the textures are created for
+ * @param cached Whether to use the glyph cache, which must already be built
+ */
+void benchTextStartup(SDL_Renderer* renderer, bool cached) {
+	SDL_Color black = {0, 0, 0, 0xff};
+	TextDisplay lines[STARTUP_LINES];
+	bool success = true;
+	Uint64 start = SDL_GetPerformanceCounter();
+	for (int i = 0; i < STARTUP_ITERATIONS && success; i++) {
+		GlyphCache glyphs;
+		TTF_Font* font = NULL;
+		if (cached) {
+			success = glyphs.open(GLYPH_CACHE_PATH, FONT_PATH, FONT_SIZE);
+		} else {
+			font = TTF_OpenFont(FONT_PATH, FONT_SIZE);
+			success = font != NULL;
+		}
+		for (int l = 0; l < STARTUP_LINES && success; l++) {
+			lines[l] = TextDisplay(font, renderer, &glyphs);
+			success = lines[l].loadText(BENCH_TEXT, black);
+		}
+		for (int l = 0; l < STARTUP_LINES; l++) {
+			lines[l].free();
+		}
+		TTF_CloseFont(font);
+	}
+	double elapsed = secondsSince(start);
+	if (!success) {
+		std::cerr << "Unable to load text for the startup benchmark\n";
+		return;
+	}
+	std::stringstream params;
+	params << "lines=" << STARTUP_LINES << " size=" << FONT_SIZE;
+	report(cached ? "text startup cached" : "text startup", params.str(),
+				 elapsed * 1e6 / STARTUP_ITERATIONS, "us/op");
+}
+
+/**
+ * Run the benchmarks that draw, using SDL's software renderer drawing into a
+ * surface with the dummy video driver so no display is needed
+ */
+void benchDrawing() {
+	SDL_SetHint(SDL_HINT_VIDEODRIVER, "dummy");
+	if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+		std::cerr << "Unable to initialize SDL: " << SDL_GetError() << '\n';
+		return;
+	}
+	SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, RENDER_DIMENSION,
+																												RENDER_DIMENSION, 32,
+																												SDL_PIXELFORMAT_ARGB8888);
+	SDL_Renderer* renderer = surface == NULL ? NULL :
+													 SDL_CreateSoftwareRenderer(surface);
+	if (renderer == NULL) {
+		std::cerr << "Unable to create renderer: " << SDL_GetError() << '\n';
+	} else {
+		if (selected("render")) {
+			GridRasterizer rasterizer(renderer);
+			for (int dimension : GRID_DIMENSIONS) {
+				benchRender(renderer, dimension, NULL);
+				benchRender(renderer, dimension, &rasterizer);
+			}
+		}
+		if (selected("loadText") || selected("text startup")) {
+			TTF_Font* font = NULL;
+			if (TTF_Init() == -1) {
+				std::cerr << "TTF Initialization Error: " << TTF_GetError() << '\n';
+			} else if ((font = TTF_OpenFont(FONT_PATH, FONT_SIZE)) == NULL) {
+				std::cerr << "Unable to load font: " << TTF_GetError() << '\n';
+			} else {
+				if (selected("loadText")) {
+					benchLoadText(renderer, font, NULL);
+				}
+				GlyphCache glyphs;
+				if (glyphs.build(font, GLYPH_CACHE_PATH, FONT_PATH, FONT_SIZE)) {
+					if (selected("loadText")) {
+						benchLoadText(renderer, NULL, &glyphs);
+					}
+					glyphs.close();
+					if (selected("text startup")) {
+						benchTextStartup(renderer, false);
+						benchTextStartup(renderer, true);
+					}
+				} else {
+					std::cerr << "Unable to write " << GLYPH_CACHE_PATH << '\n';
+				}
+				remove(GLYPH_CACHE_PATH);
+				TTF_CloseFont(font);
+			}
+			TTF_Quit();
+		}
+		SDL_DestroyRenderer(renderer);
+	}
+	SDL_FreeSurface(surface);
+	SDL_Quit();
+}
+
+// Step a generator and return its new state
+Uint64 nextBenchRandom(Uint64* state) {
+	*state = *state * 6364136223846793005ULL + 1442695040888963407ULL;
+	return *state >> 11;
+}
+
+// Settings picked at random from the ones archives are spread over
+RoundSettings randomSettings(Uint64* rng) {
+	return {ARCHIVE_DIMENSIONS[nextBenchRandom(rng) % 4],
+					ARCHIVE_DIMENSIONS[nextBenchRandom(rng) % 4],
+					ARCHIVE_APPLES[nextBenchRandom(rng) % 3], 0,
+					ARCHIVE_DELAYS[nextBenchRandom(rng) % 2],
+					ARCHIVE_ACCELERATIONS[nextBenchRandom(rng) % 2]};
+}
+
+/**
+ * Measure queries on an archive of made up replays: opening it, finding the
+ * best scores for some settings, finding the scores in a small range, and
+ * decoding the replays found
+ * @param nReplays Number of replays in the archive
+ */
+void benchArchive(int nReplays) {
+	Uint64 rng = BENCH_SEED;
+	ReplayArchiveWriter writer;
+	if (!writer.open(ARCHIVE_PATH)) {
+		std::cerr << "Unable to create " << ARCHIVE_PATH << '\n';
+		return;
+	}
+	Replay replay;
+	for (int i = 0; i < nReplays; i++) {
+		replay.start(randomSettings(&rng), rng);
+		int ticks = 50 + nextBenchRandom(&rng) % 250;
+		Direction direction = RIGHT;
+		for (int tick = 0; tick < ticks; tick++) {
+			if (nextBenchRandom(&rng) % 8 == 0) {
+				direction = (Direction) ((direction + 1 + nextBenchRandom(&rng) % 2 * 2)
+																 % NONE);
+			}
+			replay.recordTick(direction);
+		}
+		replay.finish(1 + nextBenchRandom(&rng) % ARCHIVE_MAX_SCORE);
+		writer.add(replay);
+	}
+	writer.finish();
+
+	ReplayArchive archive;
+	Uint64 start = SDL_GetPerformanceCounter();
+	bool opened = archive.open(ARCHIVE_PATH);
+	double openElapsed = secondsSince(start);
+	if (!opened) {
+		std::cerr << "Unable to open " << ARCHIVE_PATH << '\n';
+		remove(ARCHIVE_PATH);
+		return;
+	}
+
+	std::vector<const ArchiveEntry*> entries;
+	size_t found = 0;
+	start = SDL_GetPerformanceCounter();
+	for (int i = 0; i < ARCHIVE_QUERIES; i++) {
+		entries.clear();
+		found += archive.topScores(randomSettings(&rng), ARCHIVE_TOP, &entries);
+	}
+	double topElapsed = secondsSince(start);
+
+	start = SDL_GetPerformanceCounter();
+	for (int i = 0; i < ARCHIVE_QUERIES; i++) {
+		entries.clear();
+		Uint64 low = nextBenchRandom(&rng) % ARCHIVE_MAX_SCORE;
+		archive.scoreRange(randomSettings(&rng), low, low + ARCHIVE_RANGE - 1,
+											 &entries);
+	}
+	double rangeElapsed = secondsSince(start);
+
+	entries.clear();
+	archive.topScores(randomSettings(&rng), ARCHIVE_TOP, &entries);
+	start = SDL_GetPerformanceCounter();
+	for (const ArchiveEntry* entry : entries) {
+		archive.load(*entry, &replay);
+	}
+	double decodeElapsed = secondsSince(start);
+	archive.close();
+	remove(ARCHIVE_PATH);
+
+	std::stringstream params;
+	params << "replays=" << nReplays;
+	report("archive open", params.str(), openElapsed * 1000, "ms/op");
+	report("archive top", params.str() + " top=" + std::to_string(ARCHIVE_TOP) +
+				 " found=" + std::to_string(found / ARCHIVE_QUERIES),
+				 topElapsed * 1e6 / ARCHIVE_QUERIES, "us/op");
+	report("archive range", params.str() + " range=" +
+				 std::to_string(ARCHIVE_RANGE), rangeElapsed * 1e6 / ARCHIVE_QUERIES,
+				 "us/op");
+	report("archive decode", params.str(), decodeElapsed * 1e6 /
+				 std::max((size_t) 1, entries.size()), "us/op");
+}
+
+/**
+ * Measure how long the game server takes to tick and send every client the
+ * delta, and how many bytes each client is sent per tick. Clients are
+ * socket pairs whose other ends are drained between batches of ticks.
+ * @param dimension Number of rows and columns of the grid
+ */
+void benchServer(int dimension) {
+	GameServer server;
+	server.setAutoplay(true);
+	RoundSettings settings = {(Uint32) dimension, (Uint32) dimension,
+														BENCH_APPLES, 0, 0, 0};
+	if (!server.open(SERVER_PATH, settings, BENCH_SEED)) {
+		std::cerr << "Unable to listen on " << SERVER_PATH << '\n';
+		return;
+	}
+	std::vector<int> clients;
+	for (int i = 0; i < SERVER_CLIENTS; i++) {
+		int fds[2];
+		if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+			break;
+		}
+		server.addClient(fds[0]);
+		clients.push_back(fds[1]);
+	}
+	Uint64 keyframeBytes = server.getBytesSent();
+
+	Uint8 buffer[1 << 16];
+	double elapsed = 0;
+	for (int tick = 0; tick < SERVER_TICKS; tick += SERVER_DRAIN_TICKS) {
+		Uint64 start = SDL_GetPerformanceCounter();
+		for (int i = 0; i < SERVER_DRAIN_TICKS; i++) {
+			server.tick();
+		}
+		elapsed += secondsSince(start);
+		for (int fd : clients) {
+			while (recv(fd, buffer, sizeof buffer, MSG_DONTWAIT) > 0) {
+			}
+		}
+	}
+	for (int fd : clients) {
+		close(fd);
+	}
+
+	std::stringstream params;
+	params << "grid=" << dimension << 'x' << dimension << " clients="
+				 << clients.size();
+	report("server tick", params.str(), elapsed * 1e6 / SERVER_TICKS, "us/op");
+	report("server delta", params.str(), (double) (server.getBytesSent() -
+				 keyframeBytes) / SERVER_TICKS / clients.size(), "bytes/tick");
+}
+
+/**
+ * Measure how long tracing a scope takes, the cost every traced span of the
+ * game loop adds to a frame
+ * @param enabled Whether the tracer records the spans
+ */
+void benchTrace(bool enabled) {
+	Tracer::setEnabled(enabled);
+	Uint64 start = SDL_GetPerformanceCounter();
+	for (int i = 0; i < TRACE_SPANS; i++) {
+		TraceScope trace("bench", "span", i);
+	}
+	double elapsed = secondsSince(start);
+	Tracer::setEnabled(false);
+	std::stringstream params;
+	params << "enabled=" << enabled;
+	report("trace", params.str(), elapsed * 1e9 / TRACE_SPANS, "ns/span");
+}
+
+/**
+ * Measure how many ticks per second the differential fuzzer checks, each one
+ * played on SnakeGame and every variant compared with it
+ * @param nThreads Number of threads checking cases
+ */
+void benchFuzz(int nThreads) {
+	DifferentialFuzzer fuzzer(BENCH_SEED, nThreads);
+	FuzzCase failing;
+	FuzzMismatch mismatch;
+	Uint64 start = SDL_GetPerformanceCounter();
+	if (!fuzzer.run(FUZZ_CASES, &failing, &mismatch)) {
+		std::cerr << "Fuzzing disagreed: " << mismatch.variant << ' '
+							<< mismatch.detail << '\n';
+	}
+	double elapsed = secondsSince(start);
+	std::stringstream params;
+	params << "cases=" << fuzzer.getCaseCount() << " threads=" << nThreads;
+	report("fuzz", params.str(), fuzzer.getTickCount() / elapsed, "ticks/s");
+}
+
+/**
+ * Measure how many frames per second replays are exported as PNGs at, with
+ * the drawing and encoding spread over a number of threads
+ * @param nThreads Number of threads drawing and encoding
+ */
+void benchExport(int nThreads) {
+	// Record the first ticks of a round played by the heuristic policy
+	SnakeGame game;
+	Replay replay;
+	Uint64 rng = BENCH_SEED;
+	game.init(BENCH_GRID_DIMENSION, BENCH_GRID_DIMENSION, BENCH_APPLES,
+						BENCH_SEED);
+	replay.start({BENCH_GRID_DIMENSION, BENCH_GRID_DIMENSION, BENCH_APPLES, 0, 0,
+								0}, BENCH_SEED);
+	for (int tick = 0; tick < EXPORT_TICKS && game.isPlaying(); tick++) {
+		game.setDirection(RolloutEvaluator::choose(game, HEURISTIC_POLICY, &rng));
+		replay.recordTick(game.getDirection());
+		game.move();
+	}
+	replay.finish(game.getScore());
+
+	FrameExporter exporter(EXPORT_DIMENSION, NULL, nThreads);
+	Uint64 start = SDL_GetPerformanceCounter();
+	Uint64 nFrames = exporter.exportReplay(replay, EXPORT_PATH, PNG_FRAMES);
+	double elapsed = secondsSince(start);
+	std::filesystem::remove_all(EXPORT_PATH);
+	if (nFrames == 0) {
+		std::cerr << "Unable to export to " << EXPORT_PATH << '\n';
+		return;
+	}
+
+	std::stringstream params;
+	params << "size=" << EXPORT_DIMENSION << " threads=" << nThreads
+				 << " rasterizers=" << exporter.getRasterizerCount();
+	report("export png", params.str(), nFrames / elapsed, "frames/s");
+}
+
+/**
+ * Measure how late the session scheduler resumes sessions that are due, with
+ * sessions spread over a few tick rates and their starts staggered
+ * @param nSessions Number of sessions played at once
+ */
+void benchSessions(int nSessions) {
+	SessionScheduler scheduler(SESSION_THREADS);
+	for (int i = 0; i < nSessions; i++) {
+		Uint64 delay = SESSION_DELAYS[i % 3];
+		RoundSettings settings = {BENCH_GRID_DIMENSION, BENCH_GRID_DIMENSION,
+															BENCH_APPLES, 0, delay, (Uint64) i / 3 % 2};
+		scheduler.spawn(playSession(&scheduler, settings, BENCH_SEED + i,
+																SESSION_MS / delay), i % delay);
+	}
+	// Leave out the first ticks, where every session sizes its game
+	scheduler.run(SESSION_WARMUP_MS);
+	scheduler.clearLag();
+	Uint64 resumes = scheduler.getResumeCount();
+	Uint64 start = SDL_GetPerformanceCounter();
+	scheduler.run();
+	double elapsed = secondsSince(start);
+
+	std::stringstream params;
+	params << "sessions=" << nSessions << " threads=" << SESSION_THREADS;
+	report("session resumes", params.str(), (scheduler.getResumeCount() - resumes) / elapsed,
+				 "resumes/s");
+	for (double percentile : {50.0, 99.0, 99.9, 100.0}) {
+		std::stringstream name;
+		name << "session lag p" << percentile;
+		report(name.str(), params.str(),
+					 scheduler.getLagPercentile(percentile) / 1000.0, "us");
+	}
+}
+
+int main(int argc, char* argv[]) {
+	int nThreads = std::thread::hardware_concurrency();
+	if (nThreads < 1) {
+		nThreads = 1;
+	}
+
+	bool json = false;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == COMPARE_FLAG && i + 1 < argc) {
+			std::vector<std::string> paths(argv + i + 1, argv + argc);
+			return compare(paths) ? 0 : 1;
+		} else if (arg == JSON_FLAG) {
+			json = true;
+		} else if (arg == FILTER_FLAG && i + 1 < argc) {
+			filter = argv[++i];
+		} else {
+			std::cerr << "Usage: Benchmark [" << JSON_FLAG << "] [" << FILTER_FLAG
+								<< " name]\n       Benchmark " << COMPARE_FLAG
+								<< " base.csv other.csv...\n";
+			return 1;
+		}
+	}
+
+	if (selected("move")) {
+		for (int dimension : GRID_DIMENSIONS) {
+			for (int length = 1; length <= MAX_LENGTH; length *= 100) {
+				if (length <= dimension * dimension / 4) {
+					benchMove(dimension, length);
+				}
+			}
+		}
+	}
+	if (selected("init") || selected("reset") || selected("placeApple")) {
+		for (int dimension : GRID_DIMENSIONS) {
+			benchInit(dimension);
+		}
+	}
+	if (selected("render") || selected("loadText") ||
+			selected("text startup")) {
+		benchDrawing();
+	}
+	if (selected("step loop")) {
+		benchFixed<10, 10>();
+		benchFixed<20, 20>();
+		benchFixed<32, 32>();
+	}
+	if (selected("trace")) {
+		benchTrace(false);
+		benchTrace(true);
+	}
+	if (selected("clone")) {
+		benchClone();
+	}
+	if (selected("huge")) {
+		benchHugeBoard();
+	}
+	if (selected("rollout")) {
+		benchRollout(RANDOM_POLICY, 1);
+		benchRollout(HEURISTIC_POLICY, 1);
+		if (nThreads > 1) {
+			benchRollout(RANDOM_POLICY, nThreads);
+			benchRollout(HEURISTIC_POLICY, nThreads);
+		}
+	}
+	if (selected("search")) {
+		benchSearch(false);
+		benchSearch(true);
+	}
+	if (selected("world")) {
+		for (int numSnakes = 10; numSnakes <= WORLD_MAX_SNAKES; numSnakes *= 10) {
+			benchWorld(numSnakes, 1);
+			if (nThreads > 1) {
+				benchWorld(numSnakes, nThreads);
+			}
+		}
+	}
+	if (selected("archive")) {
+		for (int nReplays = 1000; nReplays <= ARCHIVE_MAX_REPLAYS; nReplays *= 10) {
+			benchArchive(nReplays);
+		}
+	}
+
+	if (selected("export")) {
+		int maxThreads = std::max(2, (int) std::thread::hardware_concurrency());
+		for (int exportThreads = 2; exportThreads <= maxThreads;
+				 exportThreads *= 2) {
+			benchExport(exportThreads);
+		}
+	}
+	if (selected("session")) {
+		for (int nSessions = 100; nSessions <= SESSION_MAX_COUNT; nSessions *= 10) {
+			benchSessions(nSessions);
+		}
+	}
+	if (selected("server")) {
+		for (int dimension : GRID_DIMENSIONS) {
+			benchServer(dimension);
+		}
+	}
+	if (selected("fuzz")) {
+		benchFuzz(1);
+		if (nThreads > 1) {
+			benchFuzz(nThreads);
+		}
+	}
+
+	if (json) {
+		writeJSON(std::cout);
+	} else {
+		writeCSV(std::cout);
+	}
+	return 0;
+}
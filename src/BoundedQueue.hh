@@ -0,0 +1,83 @@
+#ifndef BOUNDED_QUEUE_HH
+#define BOUNDED_QUEUE_HH
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+/**
+ * Queue passing items between the stages of a pipeline. Producers wait while
+ * it is full, so a fast stage cannot run ahead of a slow one, and consumers
+ * wait while it is empty until it is closed.
+ */
+template <typename T>
+class BoundedQueue {
+	public:
+		/**
+		 * Make an empty queue
+		 * @param capacity Most items the queue holds at once
+		 */
+		BoundedQueue(size_t capacity) {
+			_capacity = capacity;
+			_closed = false;
+		}
+
+		/**
+		 * Add an item, waiting for room if the queue is full
+		 * @param item The item
+		 * @return Whether it was added, items are not added once it is closed
+		 */
+		bool push(const T& item) {
+			std::unique_lock<std::mutex> lock(_mutex);
+			_notFull.wait(lock, [this] { return _closed || _items.size() < _capacity; });
+			if (_closed) {
+				return false;
+			}
+			_items.push_back(item);
+			lock.unlock();
+			_notEmpty.notify_one();
+			return true;
+		}
+
+		/**
+		 * Take the oldest item, waiting for one if the queue is empty
+		 * @param item Where the item is stored
+		 * @return Whether there was an item, false once the queue is closed and
+							 every item has been taken
+		 */
+		bool pop(T* item) {
+			std::unique_lock<std::mutex> lock(_mutex);
+			_notEmpty.wait(lock, [this] { return _closed || !_items.empty(); });
+			if (_items.empty()) {
+				return false;
+			}
+			*item = _items.front();
+			_items.pop_front();
+			lock.unlock();
+			_notFull.notify_one();
+			return true;
+		}
+
+		// Stop accepting items, waking everyone waiting on the queue
+		void close() {
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				_closed = true;
+			}
+			_notFull.notify_all();
+			_notEmpty.notify_all();
+		}
+
+		BoundedQueue(const BoundedQueue&) = delete;
+		BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+	private:
+		std::mutex _mutex;
+		std::condition_variable _notFull;
+		std::condition_variable _notEmpty;
+		std::deque<T> _items;
+		size_t _capacity;
+		bool _closed;
+};
+
+#endif
@@ -0,0 +1,174 @@
+#include <algorithm>
+#include <SDL2/SDL.h>
+
+#include "Camera.hh"
+#include "SnakeGame.hh"
+
+// Smallest cells the whole grid can be stretched into before the camera
+// starts following the head instead
+#define MIN_FIT_CELL_SIZE (4)
+
+#define DEFAULT_CELL_SIZE (16)
+#define MAX_CELL_SIZE (128)
+#define MIN_CELL_SIZE (2)
+#define PAN_STEP (4)
+
+// Start out showing the whole grid if it fits
+Camera::Camera() {
+	reset();
+	_minimap = true;
+}
+
+// Go back to showing the whole grid, centered on the head
+void Camera::reset() {
+	_cellSize = 0;
+	_panRows = 0;
+	_panCols = 0;
+}
+
+/**
+ * Zoom and pan based on keyboard and mouse input
+ * "=" / "-" or the mouse wheel zoom, "ijkl" pan, "f" recenters on the head
+ * and "m" shows or hides the minimap
+ * @param e The event being processed
+ */
+void Camera::handleEvent(SDL_Event e) {
+	if (e.type == SDL_MOUSEWHEEL) {
+		if (e.wheel.y > 0) {
+			zoomIn();
+		} else if (e.wheel.y < 0) {
+			zoomOut();
+		}
+	} else if (e.type == SDL_KEYDOWN) {
+		switch (e.key.keysym.sym) {
+			case SDLK_EQUALS:
+			case SDLK_PLUS:
+				zoomIn();
+				break;
+			case SDLK_MINUS:
+				zoomOut();
+				break;
+			case SDLK_i:
+				pan(-PAN_STEP, 0);
+				break;
+			case SDLK_k:
+				pan(PAN_STEP, 0);
+				break;
+			case SDLK_j:
+				pan(0, -PAN_STEP);
+				break;
+			case SDLK_l:
+				pan(0, PAN_STEP);
+				break;
+			case SDLK_f:
+				follow();
+				break;
+			case SDLK_m:
+				toggleMinimap();
+				break;
+		}
+	}
+}
+
+// Make cells twice as large, the first zoom leaves the stretched view
+void Camera::zoomIn() {
+	if (_cellSize == 0) {
+		_cellSize = DEFAULT_CELL_SIZE;
+	} else if (_cellSize < MAX_CELL_SIZE) {
+		_cellSize *= 2;
+	}
+}
+
+// Make cells half as large, down to a minimum size
+void Camera::zoomOut() {
+	if (_cellSize > MIN_CELL_SIZE) {
+		_cellSize /= 2;
+	}
+}
+
+/**
+ * Move the view relative to the head
+ * @param rows, cols Number of cells to move the view by
+ */
+void Camera::pan(int rows, int cols) {
+	_panRows += rows;
+	_panCols += cols;
+}
+
+// Center the view on the head again
+void Camera::follow() {
+	_panRows = 0;
+	_panCols = 0;
+}
+
+void Camera::toggleMinimap() {
+	_minimap = !_minimap;
+}
+
+/**
+ * Work out which cells are visible in the window and where they are drawn
+ * Small grids are stretched over the whole window. Larger grids, or any
+ * grid once the player zooms, are drawn with square cells around the head
+ * and kept from scrolling past the edge of the grid.
+ * @param viewport Area of the window the grid is drawn in
+ * @param game The game being drawn
+ * @return The visible part of the grid
+ */
+CameraView Camera::view(const SDL_Rect& viewport, const SnakeGame& game) const {
+	int nRows = game.getRows();
+	int nCols = game.getCols();
+	CameraView result;
+	int cellSize = _cellSize;
+	if (cellSize == 0) {
+		result.cellWidth = viewport.w / nCols;
+		result.cellHeight = viewport.h / nRows;
+		if (result.cellWidth >= MIN_FIT_CELL_SIZE &&
+				result.cellHeight >= MIN_FIT_CELL_SIZE) {
+			result.firstRow = 0;
+			result.endRow = nRows;
+			result.firstCol = 0;
+			result.endCol = nCols;
+			result.originX = 0;
+			result.originY = 0;
+			return result;
+		}
+		cellSize = DEFAULT_CELL_SIZE;
+	}
+	result.cellWidth = cellSize;
+	result.cellHeight = cellSize;
+
+	// Top left corner of the view in pixels of the whole grid
+	std::pair<int, int> head = game.getHead();
+	Sint64 gridWidth = (Sint64) nCols * cellSize;
+	Sint64 gridHeight = (Sint64) nRows * cellSize;
+	Sint64 left;
+	Sint64 top;
+	if (gridWidth <= viewport.w) { // Center grids narrower than the window
+		left = (gridWidth - viewport.w) / 2;
+	} else {
+		left = ((Sint64) head.second + _panCols) * cellSize + cellSize / 2 -
+					 viewport.w / 2;
+		left = std::clamp(left, (Sint64) 0, gridWidth - (Sint64) viewport.w);
+	}
+	if (gridHeight <= viewport.h) {
+		top = (gridHeight - viewport.h) / 2;
+	} else {
+		top = ((Sint64) head.first + _panRows) * cellSize + cellSize / 2 -
+					viewport.h / 2;
+		top = std::clamp(top, (Sint64) 0, gridHeight - (Sint64) viewport.h);
+	}
+
+	result.firstCol = left > 0 ? left / cellSize : 0;
+	result.endCol = std::min((Sint64) nCols, (left + viewport.w) / cellSize + 1);
+	result.firstRow = top > 0 ? top / cellSize : 0;
+	result.endRow = std::min((Sint64) nRows, (top + viewport.h) / cellSize + 1);
+	result.originX = -left;
+	result.originY = -top;
+	return result;
+}
+
+// Getters
+
+bool Camera::showsMinimap() const {
+	return _minimap;
+}
@@ -0,0 +1,52 @@
+#ifndef CAMERA_HH
+#define CAMERA_HH
+
+#include <SDL2/SDL.h>
+
+class SnakeGame;
+
+// Part of the grid a camera shows and where it appears in the window
+struct CameraView {
+	// Size of each cell in pixels
+	int cellWidth;
+	int cellHeight;
+
+	// Visible cells are rows [firstRow, endRow) and columns [firstCol, endCol)
+	int firstRow;
+	int endRow;
+	int firstCol;
+	int endCol;
+
+	// Pixel position of cell (0, 0), cell (r, c) is drawn at
+	// (originX + c * cellWidth, originY + r * cellHeight)
+	int originX;
+	int originY;
+};
+
+class Camera {
+	public:
+		Camera();
+		void reset();
+		void handleEvent(SDL_Event);
+		void zoomIn();
+		void zoomOut();
+		void pan(int, int);
+		void follow();
+		void toggleMinimap();
+		CameraView view(const SDL_Rect&, const SnakeGame&) const;
+
+		// Getters
+		bool showsMinimap() const;
+
+	private:
+		// Pixels per cell, 0 to stretch the whole grid over the window
+		int _cellSize;
+
+		// Offset of the center of the view from the head, in cells
+		int _panRows;
+		int _panCols;
+
+		bool _minimap; // Whether the minimap is drawn over the grid
+};
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef CHECKSUM_HH
+#define CHECKSUM_HH
+
+#include <cstring>
+#include <SDL2/SDL.h>
+
+/**
+ * Checksum of a block of memory, eight bytes at a time so checking a file
+ * costs little next to reading it
+ * @param data Start of the block
+ * @param size Size of the block in bytes
+ * @return The checksum
+ */
+inline Uint64 checksum(const void* data, size_t size) {
+	const Uint8* bytes = (const Uint8*) data;
+	Uint64 sum = 0x9e3779b97f4a7c15ULL ^ size;
+	size_t i = 0;
+	for (; i + sizeof(Uint64) <= size; i += sizeof(Uint64)) {
+		Uint64 word;
+		memcpy(&word, bytes + i, sizeof word);
+		sum = (sum ^ word) * 0x100000001b3ULL;
+		sum ^= sum >> 29;
+	}
+	for (; i < size; i++) {
+		sum = (sum ^ bytes[i]) * 0x100000001b3ULL;
+	}
+	return sum ^ (sum >> 32);
+}
+
+#endif
@@ -0,0 +1,140 @@
+#include <SDL2/SDL.h>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+#include "ChunkedGrid.hh"
+#include "GameTypes.hh"
+
+// Number of empty chunks kept in the map before they are released
+#define MAX_EMPTY_CHUNKS (64)
+
+ChunkedGrid::ChunkedGrid() {
+	_nEmpty = 0;
+}
+
+// Deep copy every allocated chunk
+ChunkedGrid::ChunkedGrid(const ChunkedGrid& other) {
+	_nEmpty = 0;
+	*this = other;
+}
+
+ChunkedGrid& ChunkedGrid::operator=(const ChunkedGrid& other) {
+	if (this != &other) {
+		clear();
+		_chunks.reserve(other._chunks.size());
+		for (const std::pair<const Uint64, Chunk*>& entry : other._chunks) {
+			Chunk* chunk = takeChunk();
+			memcpy(chunk, entry.second, sizeof(Chunk));
+			_chunks[entry.first] = chunk;
+		}
+		_nEmpty = other._nEmpty;
+	}
+	return *this;
+}
+
+ChunkedGrid::~ChunkedGrid() {
+	clear();
+	for (Chunk* chunk : _spare) {
+		delete chunk;
+	}
+}
+
+// Release every chunk, leaving the whole grid BLANK
+void ChunkedGrid::clear() {
+	for (const std::pair<const Uint64, Chunk*>& entry : _chunks) {
+		_spare.push_back(entry.second);
+	}
+	_chunks.clear();
+	_nEmpty = 0;
+}
+
+// Release every chunk whose cells are all BLANK
+void ChunkedGrid::releaseEmpty() {
+	std::unordered_map<Uint64, Chunk*>::iterator it = _chunks.begin();
+	while (it != _chunks.end()) {
+		if (it->second->nOccupied == 0) {
+			_spare.push_back(it->second);
+			it = _chunks.erase(it);
+		} else {
+			it++;
+		}
+	}
+	_nEmpty = 0;
+}
+
+// Reuse a released chunk if there is one, otherwise allocate a new one
+ChunkedGrid::Chunk* ChunkedGrid::takeChunk() {
+	if (_spare.empty()) {
+		return new Chunk;
+	}
+	Chunk* chunk = _spare.back();
+	_spare.pop_back();
+	return chunk;
+}
+
+/**
+ * Change a cell, allocating its chunk if needed
+ * @param r, c Row and column of the cell
+ * @param newVal New contents of the cell
+ */
+void ChunkedGrid::set(Sint64 r, Sint64 c, Spaces newVal) {
+	Uint64 key = chunkKey(r, c);
+	std::unordered_map<Uint64, Chunk*>::iterator it = _chunks.find(key);
+	if (it == _chunks.end()) {
+		if (newVal == BLANK) {
+			return;
+		}
+		Chunk* chunk = takeChunk();
+		for (int i = 0; i < CHUNK_DIMENSION * CHUNK_DIMENSION; i++) {
+			chunk->cells[i] = BLANK;
+		}
+		chunk->nOccupied = 0;
+		it = _chunks.emplace(key, chunk).first;
+		_nEmpty++;
+	}
+	Chunk* chunk = it->second;
+	Spaces& cell = chunk->cells[(r & (CHUNK_DIMENSION - 1)) * CHUNK_DIMENSION +
+															(c & (CHUNK_DIMENSION - 1))];
+	int wasOccupied = chunk->nOccupied;
+	chunk->nOccupied += (newVal != BLANK) - (cell != BLANK);
+	cell = newVal;
+	if (chunk->nOccupied == 0 && wasOccupied > 0) {
+		_nEmpty++;
+		if (_nEmpty > MAX_EMPTY_CHUNKS) {
+			releaseEmpty();
+		}
+	} else if (chunk->nOccupied > 0 && wasOccupied == 0) {
+		_nEmpty--;
+	}
+}
+
+/**
+ * Find every cell holding a value, only allocated chunks are searched so the
+ * value should not be BLANK
+ * @param value The value to look for
+ * @param cells Vector the row and column of each cell found are added to,
+ 								in no particular order
+ */
+void ChunkedGrid::find(Spaces value,
+											 std::vector<std::pair<Sint64, Sint64>>* cells) const {
+	for (const std::pair<const Uint64, Chunk*>& entry : _chunks) {
+		if (entry.second->nOccupied == 0) {
+			continue;
+		}
+		Sint64 firstRow = (Sint64) (entry.first >> 32) << CHUNK_SHIFT;
+		Sint64 firstCol = (Sint64) (entry.first & 0xffffffff) << CHUNK_SHIFT;
+		for (int i = 0; i < CHUNK_DIMENSION * CHUNK_DIMENSION; i++) {
+			if (entry.second->cells[i] == value) {
+				cells->push_back(std::pair(firstRow + (i >> CHUNK_SHIFT),
+																	 firstCol + (i & (CHUNK_DIMENSION - 1))));
+			}
+		}
+	}
+}
+
+// Getters
+
+size_t ChunkedGrid::getChunkCount() const {
+	return _chunks.size();
+}
@@ -0,0 +1,75 @@
+#ifndef CHUNKED_GRID_HH
+#define CHUNKED_GRID_HH
+
+#include <SDL2/SDL.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "GameTypes.hh"
+
+// Width and height of each chunk, a power of two
+#define CHUNK_SHIFT (6)
+#define CHUNK_DIMENSION (1 << CHUNK_SHIFT)
+
+/**
+ * Grid of Spaces for boards too large to store every cell
+ * Chunks are allocated the first time one of their cells is set to something
+ * other than BLANK. Chunks whose cells are all BLANK again are released in
+ * batches, so memory and time depend on what is on the board rather than its
+ * area, and a snake moving back and forth across a chunk border does not
+ * allocate every tick. Released chunks are kept for reuse instead of being
+ * freed.
+ */
+class ChunkedGrid {
+	public:
+		ChunkedGrid();
+		ChunkedGrid(const ChunkedGrid&);
+		ChunkedGrid& operator=(const ChunkedGrid&);
+		~ChunkedGrid();
+		void clear();
+		inline Spaces get(Sint64, Sint64) const;
+		void set(Sint64, Sint64, Spaces);
+		void find(Spaces, std::vector<std::pair<Sint64, Sint64>>*) const;
+
+		// Getters
+		size_t getChunkCount() const;
+
+	private:
+		struct Chunk {
+			Spaces cells[CHUNK_DIMENSION * CHUNK_DIMENSION];
+			int nOccupied; // Number of cells that are not BLANK
+		};
+
+		// Allocated chunks keyed by chunk row and column
+		std::unordered_map<Uint64, Chunk*> _chunks;
+
+		// Number of chunks in _chunks whose cells are all BLANK
+		size_t _nEmpty;
+
+		// Released chunks waiting to be reused
+		std::vector<Chunk*> _spare;
+
+		Chunk* takeChunk();
+		void releaseEmpty();
+
+		static inline Uint64 chunkKey(Sint64, Sint64);
+};
+
+// Key of the chunk holding a cell
+inline Uint64 ChunkedGrid::chunkKey(Sint64 r, Sint64 c) {
+	return ((Uint64) (r >> CHUNK_SHIFT) << 32) | (Uint64) (c >> CHUNK_SHIFT);
+}
+
+// Contents of a cell, cells of chunks that were never allocated are BLANK
+inline Spaces ChunkedGrid::get(Sint64 r, Sint64 c) const {
+	std::unordered_map<Uint64, Chunk*>::const_iterator it =
+			_chunks.find(chunkKey(r, c));
+	if (it == _chunks.end()) {
+		return BLANK;
+	}
+	return it->second->cells[(r & (CHUNK_DIMENSION - 1)) * CHUNK_DIMENSION +
+													 (c & (CHUNK_DIMENSION - 1))];
+}
+
+#endif
@@ -0,0 +1,612 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <SDL2/SDL.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "DifferentialFuzzer.hh"
+#include "FixedSnakeGame.hh"
+#include "GameTypes.hh"
+#include "Rollout.hh"
+#include "SnakeGame.hh"
+
+// Cases handed to a worker at a time
+#define CASES_PER_TASK (64)
+
+// Cases end after this many ticks if the game has not ended
+#define MAX_CASE_TICKS (4096)
+
+// Most apples a case starts with, and at most half of the cells
+#define MAX_FUZZ_APPLES (16)
+
+// One tick in this many makes each kind of copy before it
+#define COPY_ODDS (64)
+
+// One tick in this many presses a random key, even into a wall or backwards,
+// and as many press nothing. The others steer like Headless.
+#define RANDOM_KEY_ODDS (16)
+
+// Characters of each direction in a formatted case, NONE is '.'
+static const char DIRECTION_KEYS[] = "DLUR.";
+#define CLONE_KEY ('c')
+#define SNAPSHOT_KEY ('s')
+#define NO_TICKS ("-")
+
+// Mix the bits of a value (splitmix64 finalizer), used to derive seeds
+static Uint64 mix(Uint64 z) {
+	z += 0x9e3779b97f4a7c15ULL;
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+static const char* spaceName(Spaces space) {
+	static const char* names[] = {"HEAD", "BODY", "APPLE", "BLANK"};
+	return space <= BLANK ? names[space] : "?";
+}
+
+static const char* directionName(Direction direction) {
+	static const char* names[] = {"DOWN", "LEFT", "UP", "RIGHT", "NONE"};
+	return direction <= NONE ? names[direction] : "?";
+}
+
+/**
+ * Record a disagreement
+ * @return false, so checks can return it directly
+ */
+static bool disagree(FuzzMismatch* mismatch, Uint64 tick, const char* variant,
+										 const std::string& detail) {
+	mismatch->tick = tick;
+	mismatch->variant = variant;
+	mismatch->detail = detail;
+	return false;
+}
+
+/**
+ * Compare what a variant reports about its game with the reference
+ * @param reference The reference game
+ * @param game The variant's game
+ * @param tick Ticks played so far
+ * @param variant Name of the variant
+ * @param mismatch Where a disagreement is recorded
+ * @return Whether they agree
+ */
+template <typename Game>
+static bool sameState(const SnakeGame& reference, const Game& game, Uint64 tick,
+											const char* variant, FuzzMismatch* mismatch) {
+	bool playing = reference.isPlaying();
+	if (game.isPlaying() == playing && game.getScore() == reference.getScore() &&
+			game.getDirection() == reference.getDirection() &&
+			(!playing || game.getHead() == reference.getHead())) {
+		return true;
+	}
+	std::stringstream detail;
+	if (game.isPlaying() != playing) {
+		detail << "playing is " << game.isPlaying() << ", reference has "
+					 << playing;
+	} else if (game.getScore() != reference.getScore()) {
+		detail << "score is " << game.getScore() << ", reference has "
+					 << reference.getScore();
+	} else if (game.getDirection() != reference.getDirection()) {
+		detail << "direction is " << directionName(game.getDirection())
+					 << ", reference has " << directionName(reference.getDirection());
+	} else {
+		detail << "head is at (" << game.getHead().first << ", "
+					 << game.getHead().second << "), reference has ("
+					 << reference.getHead().first << ", "
+					 << reference.getHead().second << ')';
+	}
+	return disagree(mismatch, tick, variant, detail.str());
+}
+
+/**
+ * Compare one cell of a variant's grid with the reference
+ * @param reference The reference game
+ * @param value What the variant has in the cell
+ * @param r, c The cell
+ * @param tick Ticks played so far
+ * @param variant Name of the variant
+ * @param mismatch Where a disagreement is recorded
+ * @return Whether they agree
+ */
+static bool sameCell(const SnakeGame& reference, Spaces value, int r, int c,
+										 Uint64 tick, const char* variant, FuzzMismatch* mismatch) {
+	if (value == reference.getCell(r, c)) {
+		return true;
+	}
+	std::stringstream detail;
+	detail << "cell (" << r << ", " << c << ") is " << spaceName(value)
+				 << ", reference has " << spaceName(reference.getCell(r, c));
+	return disagree(mismatch, tick, variant, detail.str());
+}
+
+/**
+ * Compare the results of calling the same method on every variant
+ * @param expected What the reference returned
+ * @param results What the fixed, clone and snapshot variants returned
+ * @param method Name of the method
+ * @param tick Ticks played so far
+ * @param mismatch Where a disagreement is recorded
+ * @return Whether they agree
+ */
+static bool sameResults(bool expected, const bool results[3],
+												const char* method, Uint64 tick,
+												FuzzMismatch* mismatch) {
+	static const char* variants[] = {"fixed", "clone", "snapshot"};
+	for (int i = 0; i < 3; i++) {
+		if (results[i] != expected) {
+			std::stringstream detail;
+			detail << method << " returned " << results[i] << ", reference returned "
+						 << expected;
+			return disagree(mismatch, tick, variants[i], detail.str());
+		}
+	}
+	return true;
+}
+
+/**
+ * Pick the next tick of a case being generated
+ * @param reference The reference game as the tick starts
+ * @param rng State of the generator picking ticks
+ * @return The tick
+ */
+static FuzzTick nextTick(const SnakeGame& reference, Uint64* rng) {
+	*rng = mix(*rng);
+	Uint64 bits = *rng;
+	FuzzTick tick = {NONE, NO_COPY};
+	if (bits % COPY_ODDS == 0) {
+		tick.copy = CLONE_COPY;
+	} else if (bits % COPY_ODDS == 1) {
+		tick.copy = SNAPSHOT_COPY;
+	}
+	bits /= COPY_ODDS;
+	if (bits % RANDOM_KEY_ODDS == 0) {
+		tick.direction = (Direction) (bits / RANDOM_KEY_ODDS % NONE);
+	} else if (bits % RANDOM_KEY_ODDS != 1) {
+		tick.direction = RolloutEvaluator::choose(reference, HEURISTIC_POLICY, rng);
+	}
+	return tick;
+}
+
+/**
+ * Make the games each thread checks cases with
+ * @param seed Seed every case is derived from, runs with the same seed check
+ 							 the same cases
+ * @param nThreads Number of threads checking cases, 0 uses one per core
+ */
+DifferentialFuzzer::DifferentialFuzzer(Uint64 seed, int nThreads)
+	: _pool(nThreads) {
+	_seed = seed;
+	_nextCase = 0;
+	_nCases = 0;
+	_nTicks = 0;
+	_lanes.resize(_pool.getThreadCount());
+	for (Lane& lane : _lanes) {
+		lane.reference.enableChangeLog(true);
+		lane.currentClone = 0;
+		lane.currentRestored = 0;
+	}
+}
+
+/**
+ * Generate and check the next cases, continuing from the last run
+ * @param nCases Number of cases
+ * @param failing Where the first case that disagreed is copied
+ * @param mismatch Where its disagreement is recorded
+ * @return Whether every case agreed. Otherwise the case reported is the
+ 					 earliest one that disagreed, whatever the number of threads.
+ */
+bool DifferentialFuzzer::run(Uint64 nCases, FuzzCase* failing,
+														 FuzzMismatch* mismatch) {
+	Uint64 first = _nextCase;
+	_nextCase += nCases;
+	std::atomic<Uint64> failedCase(UINT64_MAX);
+	std::mutex failedMutex;
+	int nTasks = (nCases + CASES_PER_TASK - 1) / CASES_PER_TASK;
+	_pool.run(nTasks, [&](int task, int worker) {
+		Lane& lane = _lanes[worker];
+		Uint64 end = std::min(first + (Uint64) (task + 1) * CASES_PER_TASK,
+													first + nCases);
+		for (Uint64 i = first + (Uint64) task * CASES_PER_TASK; i < end; i++) {
+			// Later cases can not be the earliest to disagree
+			if (i > failedCase.load(std::memory_order_relaxed)) {
+				return;
+			}
+			generate(i, &lane.generated);
+			FuzzMismatch found;
+			if (!playCase(lane, &lane.generated, true, mix(_seed ^ mix(i)),
+										&found)) {
+				std::lock_guard<std::mutex> lock(failedMutex);
+				if (i < failedCase) {
+					failedCase = i;
+					*failing = lane.generated;
+					*mismatch = found;
+				}
+				return;
+			}
+		}
+	});
+	return failedCase == UINT64_MAX;
+}
+
+/**
+ * Play a case again, for example one made by format and parse
+ * @param fuzzCase The case
+ * @param mismatch Where a disagreement is recorded
+ * @return Whether every variant agreed with the reference
+ */
+bool DifferentialFuzzer::check(const FuzzCase& fuzzCase,
+															 FuzzMismatch* mismatch) {
+	Lane& lane = _lanes[0];
+	lane.generated = fuzzCase;
+	return playCase(lane, &lane.generated, false, 0, mismatch);
+}
+
+/**
+ * Make a case that disagrees as small as possible while the same variant
+ * still disagrees: ticks after the disagreement are cut, runs of ticks are
+ * dropped, the remaining ticks lose their copies and key presses, and fewer
+ * apples and smaller grids are tried, until none of that helps
+ * @param fuzzCase The case, replaced by the smallest one found
+ * @param mismatch Its disagreement, replaced by that of the smallest case
+ */
+void DifferentialFuzzer::shrink(FuzzCase* fuzzCase, FuzzMismatch* mismatch) {
+	std::string variant = mismatch->variant;
+	bool shrunk = true;
+	while (shrunk) {
+		shrunk = false;
+		if (fuzzCase->ticks.size() > mismatch->tick) {
+			fuzzCase->ticks.resize(mismatch->tick);
+		}
+
+		// Drop runs of ticks, from half of them down to single ticks
+		for (size_t length = std::max((size_t) 1, fuzzCase->ticks.size() / 2);
+				 length > 0; length /= 2) {
+			size_t start = 0;
+			while (start + length <= fuzzCase->ticks.size()) {
+				FuzzCase candidate = *fuzzCase;
+				candidate.ticks.erase(candidate.ticks.begin() + start,
+															candidate.ticks.begin() + start + length);
+				if (stillFails(candidate, variant, mismatch)) {
+					*fuzzCase = candidate;
+					shrunk = true;
+				} else {
+					start += length;
+				}
+			}
+		}
+
+		for (size_t i = 0; i < fuzzCase->ticks.size(); i++) {
+			FuzzCase candidate = *fuzzCase;
+			if (candidate.ticks[i].copy != NO_COPY) {
+				candidate.ticks[i].copy = NO_COPY;
+				if (stillFails(candidate, variant, mismatch)) {
+					*fuzzCase = candidate;
+					shrunk = true;
+				}
+			}
+			candidate = *fuzzCase;
+			if (candidate.ticks[i].direction != NONE) {
+				candidate.ticks[i].direction = NONE;
+				if (stillFails(candidate, variant, mismatch)) {
+					*fuzzCase = candidate;
+					shrunk = true;
+				}
+			}
+		}
+
+		for (int apples = 1; apples < fuzzCase->apples; apples++) {
+			FuzzCase candidate = *fuzzCase;
+			candidate.apples = apples;
+			if (stillFails(candidate, variant, mismatch)) {
+				*fuzzCase = candidate;
+				shrunk = true;
+				break;
+			}
+		}
+
+		std::vector<std::pair<int, int>> sizes = getSizes();
+		std::sort(sizes.begin(), sizes.end(), [](std::pair<int, int> a,
+																						 std::pair<int, int> b) {
+			return a.first * a.second < b.first * b.second;
+		});
+		for (std::pair<int, int> size : sizes) {
+			if (size.first * size.second >= fuzzCase->rows * fuzzCase->cols) {
+				break;
+			}
+			FuzzCase candidate = *fuzzCase;
+			candidate.rows = size.first;
+			candidate.cols = size.second;
+			if (candidate.apples < size.first * size.second &&
+					stillFails(candidate, variant, mismatch)) {
+				*fuzzCase = candidate;
+				shrunk = true;
+				break;
+			}
+		}
+	}
+}
+
+/**
+ * Write a case as the arguments parse reads: rows, columns, apples, seed and
+ * then a character per tick, D, L, U or R for a key and . for none, after c
+ * or s when the clone or snapshot variant is copied first
+ * @param fuzzCase The case
+ * @return The arguments separated by spaces
+ */
+std::string DifferentialFuzzer::format(const FuzzCase& fuzzCase) {
+	std::stringstream text;
+	text << fuzzCase.rows << ' ' << fuzzCase.cols << ' ' << fuzzCase.apples << ' '
+			 << fuzzCase.seed << ' ';
+	if (fuzzCase.ticks.empty()) {
+		text << NO_TICKS;
+	}
+	for (const FuzzTick& tick : fuzzCase.ticks) {
+		if (tick.copy == CLONE_COPY) {
+			text << CLONE_KEY;
+		} else if (tick.copy == SNAPSHOT_COPY) {
+			text << SNAPSHOT_KEY;
+		}
+		text << DIRECTION_KEYS[tick.direction];
+	}
+	return text.str();
+}
+
+/**
+ * Read a case written by format
+ * @param args The five arguments
+ * @param fuzzCase Where the case is stored
+ * @return Whether the arguments were a case of a size that is checked
+ */
+bool DifferentialFuzzer::parse(const std::vector<std::string>& args,
+															 FuzzCase* fuzzCase) {
+	if (args.size() != 5) {
+		return false;
+	}
+	fuzzCase->rows = atoi(args[0].c_str());
+	fuzzCase->cols = atoi(args[1].c_str());
+	fuzzCase->apples = atoi(args[2].c_str());
+	fuzzCase->seed = strtoull(args[3].c_str(), NULL, 10);
+	const std::vector<std::pair<int, int>>& sizes = getSizes();
+	if (std::find(sizes.begin(), sizes.end(),
+								std::pair(fuzzCase->rows, fuzzCase->cols)) == sizes.end() ||
+			fuzzCase->apples < 1 ||
+			fuzzCase->apples >= fuzzCase->rows * fuzzCase->cols) {
+		return false;
+	}
+
+	fuzzCase->ticks.clear();
+	FuzzTick tick = {NONE, NO_COPY};
+	for (char key : args[4] == NO_TICKS ? std::string() : args[4]) {
+		if (key == CLONE_KEY && tick.copy == NO_COPY) {
+			tick.copy = CLONE_COPY;
+		} else if (key == SNAPSHOT_KEY && tick.copy == NO_COPY) {
+			tick.copy = SNAPSHOT_COPY;
+		} else if (key != '\0' && strchr(DIRECTION_KEYS, key) != NULL) {
+			tick.direction = (Direction) (strchr(DIRECTION_KEYS, key) -
+																		DIRECTION_KEYS);
+			fuzzCase->ticks.push_back(tick);
+			tick = {NONE, NO_COPY};
+		} else {
+			return false;
+		}
+	}
+	return tick.copy == NO_COPY;
+}
+
+/**
+ * Pick the settings of a generated case, its ticks are picked as it is played
+ * @param index Index of the case since the fuzzer was made
+ * @param fuzzCase Where the settings are stored, with no ticks
+ */
+void DifferentialFuzzer::generate(Uint64 index, FuzzCase* fuzzCase) {
+	Uint64 bits = mix(_seed + mix(index));
+	const std::vector<std::pair<int, int>>& sizes = getSizes();
+	std::pair<int, int> size = sizes[bits % sizes.size()];
+	bits /= sizes.size();
+	fuzzCase->rows = size.first;
+	fuzzCase->cols = size.second;
+	fuzzCase->apples = 1 + bits % std::min(MAX_FUZZ_APPLES,
+																				 std::max(1, size.first * size.second / 2));
+	fuzzCase->seed = mix(bits);
+	fuzzCase->ticks.clear();
+}
+
+/**
+ * Play a case on the FixedSnakeGame of its size
+ * @param lane Games of the thread playing it
+ * @param fuzzCase The case
+ * @param generating Whether its ticks are picked as it is played, until the
+ 										 game ends, or read from the case
+ * @param rng State of the generator picking ticks
+ * @param mismatch Where a disagreement is recorded
+ * @return Whether every variant agreed with the reference
+ */
+bool DifferentialFuzzer::playCase(Lane& lane, FuzzCase* fuzzCase,
+																	bool generating, Uint64 rng,
+																	FuzzMismatch* mismatch) {
+	_nCases.fetch_add(1, std::memory_order_relaxed);
+	// Every size here needs to be in getSizes and the other way around
+	int rows = fuzzCase->rows;
+	int cols = fuzzCase->cols;
+	if (rows == 1 && cols == 8) {
+		return play<1, 8>(lane, fuzzCase, generating, rng, mismatch);
+	} else if (rows == 3 && cols == 3) {
+		return play<3, 3>(lane, fuzzCase, generating, rng, mismatch);
+	} else if (rows == 4 && cols == 7) {
+		return play<4, 7>(lane, fuzzCase, generating, rng, mismatch);
+	} else if (rows == 7 && cols == 4) {
+		return play<7, 4>(lane, fuzzCase, generating, rng, mismatch);
+	} else if (rows == 8 && cols == 8) {
+		return play<8, 8>(lane, fuzzCase, generating, rng, mismatch);
+	} else if (rows == 12 && cols == 12) {
+		return play<12, 12>(lane, fuzzCase, generating, rng, mismatch);
+	} else if (rows == 20 && cols == 20) {
+		return play<20, 20>(lane, fuzzCase, generating, rng, mismatch);
+	}
+	return disagree(mismatch, 0, "fixed", "no FixedSnakeGame of this size");
+}
+
+/**
+ * Play a case on the reference and every variant in lockstep
+ * @param lane Games of the thread playing it
+ * @param fuzzCase The case
+ * @param generating Whether its ticks are picked as it is played, until the
+ 										 game ends, or read from the case
+ * @param rng State of the generator picking ticks
+ * @param mismatch Where a disagreement is recorded
+ * @return Whether every variant agreed with the reference
+ */
+template <int Rows, int Cols>
+bool DifferentialFuzzer::play(Lane& lane, FuzzCase* fuzzCase, bool generating,
+															Uint64 rng, FuzzMismatch* mismatch) {
+	SnakeGame& reference = lane.reference;
+	FixedSnakeGame<Rows, Cols> fixed;
+	int apples = fuzzCase->apples;
+	Uint64 seed = fuzzCase->seed;
+	reference.init(Rows, Cols, apples, seed);
+	fixed.init(apples, seed);
+	lane.currentClone = 0;
+	lane.clones[0].init(Rows, Cols, apples, seed);
+	lane.currentRestored = 0;
+	lane.restored[0].init(Rows, Cols, apples, seed);
+	lane.mirror.assign(Rows * Cols, BLANK);
+	lane.cells.clear();
+	reference.listCells(&lane.cells);
+	for (const CellChange& cell : lane.cells) {
+		lane.mirror[cell.row * Cols + cell.col] = cell.value;
+	}
+
+	// Every cell is compared after init and after the last tick
+	auto sameGrids = [&](Uint64 tick) {
+		for (int r = 0; r < Rows; r++) {
+			for (int c = 0; c < Cols; c++) {
+				if (!sameCell(reference, fixed.getCell(r, c), r, c, tick, "fixed",
+											mismatch) ||
+						!sameCell(reference, lane.clones[lane.currentClone].getCell(r, c), r, c,
+											tick, "clone", mismatch) ||
+						!sameCell(reference, lane.restored[lane.currentRestored].getCell(r, c), r,
+											c, tick, "snapshot", mismatch) ||
+						!sameCell(reference, lane.mirror[r * Cols + c], r, c, tick,
+											"change log", mismatch)) {
+					return false;
+				}
+			}
+		}
+		return true;
+	};
+	if (!sameGrids(0)) {
+		return false;
+	}
+
+	Uint64 tick = 0;
+	bool agree = true;
+	while (agree && (generating ? tick < MAX_CASE_TICKS :
+													 tick < fuzzCase->ticks.size())) {
+		if (generating) {
+			fuzzCase->ticks.push_back(nextTick(reference, &rng));
+		}
+		const FuzzTick& next = fuzzCase->ticks[tick++];
+		if (next.copy == CLONE_COPY) {
+			lane.clones[lane.currentClone].clone(lane.clones[!lane.currentClone]);
+			lane.currentClone = !lane.currentClone;
+		} else if (next.copy == SNAPSHOT_COPY) {
+			SnakeGame& from = lane.restored[lane.currentRestored];
+			lane.snapshot.resize(from.getSnapshotSize());
+			from.writeSnapshot(lane.snapshot.data());
+			lane.currentRestored = !lane.currentRestored;
+			if (!lane.restored[lane.currentRestored].readSnapshot(lane.snapshot.data(),
+																										lane.snapshot.size())) {
+				agree = disagree(mismatch, tick, "snapshot",
+												 "its own snapshot could not be read");
+				break;
+			}
+		}
+		SnakeGame& cloned = lane.clones[lane.currentClone];
+		SnakeGame& restored = lane.restored[lane.currentRestored];
+
+		if (next.direction != NONE) {
+			bool expected = reference.setDirection(next.direction);
+			bool results[] = {fixed.setDirection(next.direction),
+												cloned.setDirection(next.direction),
+												restored.setDirection(next.direction)};
+			if (!sameResults(expected, results, "setDirection", tick, mismatch)) {
+				agree = false;
+				break;
+			}
+		}
+		reference.clearChanges();
+		bool playing = reference.move();
+		bool results[] = {fixed.move(), cloned.move(), restored.move()};
+		for (const CellChange& change : reference.getChanges()) {
+			lane.mirror[change.row * Cols + change.col] = change.value;
+		}
+
+		agree = sameResults(playing, results, "move", tick, mismatch) &&
+						sameState(reference, fixed, tick, "fixed", mismatch) &&
+						sameState(reference, cloned, tick, "clone", mismatch) &&
+						sameState(reference, restored, tick, "snapshot", mismatch);
+		for (const CellChange& change : reference.getChanges()) {
+			int r = change.row;
+			int c = change.col;
+			agree = agree &&
+							sameCell(reference, fixed.getCell(r, c), r, c, tick, "fixed",
+											 mismatch) &&
+							sameCell(reference, cloned.getCell(r, c), r, c, tick, "clone",
+											 mismatch) &&
+							sameCell(reference, restored.getCell(r, c), r, c, tick,
+											 "snapshot", mismatch);
+		}
+		if (agree && cloned.getHash() != reference.getHash()) {
+			agree = disagree(mismatch, tick, "clone", "hash differs from reference");
+		} else if (agree && restored.getHash() != reference.getHash()) {
+			agree = disagree(mismatch, tick, "snapshot",
+											 "hash differs from reference");
+		}
+		if (!playing) {
+			break;
+		}
+	}
+	_nTicks.fetch_add(tick, std::memory_order_relaxed);
+	return agree && sameGrids(tick);
+}
+
+// Whether a smaller case still makes the same variant disagree
+bool DifferentialFuzzer::stillFails(const FuzzCase& candidate,
+																		const std::string& variant,
+																		FuzzMismatch* mismatch) {
+	FuzzMismatch found;
+	if (check(candidate, &found) || found.variant != variant) {
+		return false;
+	}
+	*mismatch = found;
+	return true;
+}
+
+// Getters
+
+// Cases played over every run and check so far
+Uint64 DifferentialFuzzer::getCaseCount() const {
+	return _nCases;
+}
+
+// Ticks played by the reference over every case so far
+Uint64 DifferentialFuzzer::getTickCount() const {
+	return _nTicks;
+}
+
+int DifferentialFuzzer::getThreadCount() const {
+	return _pool.getThreadCount();
+}
+
+// Sizes of the cases, each needs a FixedSnakeGame in playCase
+const std::vector<std::pair<int, int>>& DifferentialFuzzer::getSizes() {
+	static const std::vector<std::pair<int, int>> sizes = {
+		{1, 8}, {3, 3}, {4, 7}, {7, 4}, {8, 8}, {12, 12}, {20, 20}
+	};
+	return sizes;
+}
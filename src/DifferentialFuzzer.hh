@@ -0,0 +1,112 @@
+#ifndef DIFFERENTIAL_FUZZER_HH
+#define DIFFERENTIAL_FUZZER_HH
+
+#include <atomic>
+#include <SDL2/SDL.h>
+#include <string>
+#include <vector>
+
+#include "GameTypes.hh"
+#include "SnakeGame.hh"
+#include "WorkerPool.hh"
+
+// How a variant's game is carried over to its spare game before a tick
+enum FuzzCopy : Uint8 {
+	NO_COPY,
+	CLONE_COPY,   // The clone variant continues in a clone of its game
+	SNAPSHOT_COPY // The snapshot variant continues from a snapshot of its game
+};
+
+// One tick of a case: the key pressed, NONE if none, and any copy made first
+struct FuzzTick {
+	Direction direction;
+	FuzzCopy copy;
+};
+
+// Everything needed to play a case again, the size is one of getSizes()
+struct FuzzCase {
+	int rows;
+	int cols;
+	int apples;
+	Uint64 seed;
+	std::vector<FuzzTick> ticks;
+};
+
+// First place a variant disagreed with the reference
+struct FuzzMismatch {
+	// Ticks played including the one that disagreed, 0 when the games already
+	// disagreed after init and the number of ticks when only the final check of
+	// every cell disagreed
+	Uint64 tick;
+	std::string variant;
+	std::string detail;
+};
+
+/**
+ * Plays seeded random games on SnakeGame and on every variant that must
+ * behave exactly like it, in lockstep, and reports the first disagreement
+ * The variants are FixedSnakeGame, a game that keeps being cloned into a
+ * spare game, a game that keeps being restored from its own snapshot into a
+ * spare game, and a grid kept only from the reference's change log the way
+ * GameServer clients keep theirs. After each tick the scores, game over
+ * flags, heads, directions and hashes are compared, as well as every cell the
+ * reference changed. Every cell is compared after init and when a case ends.
+ * Cases are split across threads and each one reuses its games, so checking
+ * does not allocate once the games have grown.
+ */
+class DifferentialFuzzer {
+	public:
+		DifferentialFuzzer(Uint64, int = 0);
+		DifferentialFuzzer(const DifferentialFuzzer&) = delete;
+		DifferentialFuzzer& operator=(const DifferentialFuzzer&) = delete;
+		bool run(Uint64, FuzzCase*, FuzzMismatch*);
+		bool check(const FuzzCase&, FuzzMismatch*);
+		void shrink(FuzzCase*, FuzzMismatch*);
+		static std::string format(const FuzzCase&);
+		static bool parse(const std::vector<std::string>&, FuzzCase*);
+
+		// Getters
+		Uint64 getCaseCount() const;
+		Uint64 getTickCount() const;
+		int getThreadCount() const;
+		static const std::vector<std::pair<int, int>>& getSizes();
+
+	private:
+		// Games checked by one worker, reused from case to case
+		struct Lane {
+			SnakeGame reference;
+
+			// The clone and snapshot variants switch between two games
+			SnakeGame clones[2];
+			int currentClone;
+			SnakeGame restored[2];
+			int currentRestored;
+			std::vector<Uint8> snapshot;
+
+			// Grid built from the reference's change log, row by row
+			std::vector<Spaces> mirror;
+			std::vector<CellChange> cells;
+
+			FuzzCase generated;
+		};
+
+		Uint64 _seed;
+
+		// Index of the case the next run starts at
+		Uint64 _nextCase;
+
+		// Cases and ticks played so far
+		std::atomic<Uint64> _nCases;
+		std::atomic<Uint64> _nTicks;
+
+		std::vector<Lane> _lanes;
+		WorkerPool _pool;
+
+		template <int Rows, int Cols>
+		bool play(Lane&, FuzzCase*, bool, Uint64, FuzzMismatch*);
+		bool playCase(Lane&, FuzzCase*, bool, Uint64, FuzzMismatch*);
+		void generate(Uint64, FuzzCase*);
+		bool stillFails(const FuzzCase&, const std::string&, FuzzMismatch*);
+};
+
+#endif
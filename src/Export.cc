@@ -0,0 +1,111 @@
+#include <cstdlib>
+#include <iostream>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <string>
+#include <vector>
+
+#include "FrameExporter.hh"
+#include "Replay.hh"
+#include "ReplayArchive.hh"
+
+#define DEFAULT_APPLES (3)
+#define DEFAULT_ARCHIVE_PATH ("replays.bin")
+#define DEFAULT_GRID_DIMENSION (20)
+#define DEFAULT_OUTPUT_PATH ("frames")
+#define EXPORT_DIMENSION (800)
+#define RAW_FLAG ("--raw")
+
+/**
+ * Export the best replay of a Headless archive as video frames, drawn the way
+ * Main draws the game in its starting window size
+ * Frames are a directory of PNGs, or with --raw one file of 32-bit BGRA
+ * frames that video tools read as raw video
+ * Usage: Export [archive] [output] [rows] [cols] [apples] [threads] [--raw]
+ */
+int main(int argc, char* argv[]) {
+	std::vector<std::string> args;
+	FrameFormat format = PNG_FRAMES;
+	for (int i = 1; i < argc; i++) {
+		if (std::string(argv[i]) == RAW_FLAG) {
+			format = RAW_FRAMES;
+		} else {
+			args.push_back(argv[i]);
+		}
+	}
+	std::string archivePath = args.size() > 0 ? args[0] : DEFAULT_ARCHIVE_PATH;
+	std::string output = args.size() > 1 ? args[1] : DEFAULT_OUTPUT_PATH;
+	int nRows = args.size() > 2 ? atoi(args[2].c_str()) : DEFAULT_GRID_DIMENSION;
+	int nCols = args.size() > 3 ? atoi(args[3].c_str()) : DEFAULT_GRID_DIMENSION;
+	int numApples = args.size() > 4 ? atoi(args[4].c_str()) : DEFAULT_APPLES;
+	int nThreads = args.size() > 5 ? atoi(args[5].c_str()) : 0;
+	if (nRows < 1 || nCols < 1 || numApples < 1 || nThreads < 0) {
+		std::cout << "Usage: " << argv[0] << " [archive] [output] [rows] [cols]"
+							<< " [apples] [threads] [" << RAW_FLAG << "]\n";
+		return 1;
+	}
+
+	// Headless archives rounds with no time delay or acceleration
+	RoundSettings settings = {(Uint32) nRows, (Uint32) nCols, (Uint32) numApples,
+														0, 0, 0};
+	ReplayArchive archive;
+	std::vector<const ArchiveEntry*> best;
+	Replay replay;
+	if (!archive.open(archivePath)) {
+		std::cout << "Unable to open " << archivePath << '\n';
+		return 1;
+	}
+	if (archive.topScores(settings, 1, &best) == 0 ||
+			!archive.load(*best[0], &replay)) {
+		std::cout << "No replay of a " << nRows << 'x' << nCols << " game with "
+							<< numApples << " apple(s) in " << archivePath << '\n';
+		return 1;
+	}
+
+	SDL_SetHint(SDL_HINT_VIDEODRIVER, "dummy");
+	if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+		std::cout << "Unable to initialize SDL: " << SDL_GetError() << '\n';
+		return 1;
+	}
+	int imgFlags = IMG_INIT_PNG | IMG_INIT_JPG;
+	if (!(IMG_Init(imgFlags) & imgFlags)) {
+		std::cout << "IMG Initialization Error: " << IMG_GetError() << '\n';
+		SDL_Quit();
+		return 1;
+	}
+	SDL_Surface* head = IMG_Load("images/snake_head.png");
+	if (head == NULL) {
+		head = IMG_Load("images/snake_head.jpg");
+	}
+	if (head == NULL) {
+		std::cout << "No head image loaded: " << IMG_GetError() << '\n';
+	}
+
+	Uint64 nFrames;
+	double elapsed;
+	int nRasterizers;
+	int nEncoders;
+	{
+		FrameExporter exporter(EXPORT_DIMENSION, head, nThreads);
+		nRasterizers = exporter.getRasterizerCount();
+		nEncoders = exporter.getEncoderCount();
+		Uint64 start = SDL_GetPerformanceCounter();
+		nFrames = exporter.exportReplay(replay, output, format);
+		elapsed = (double) (SDL_GetPerformanceCounter() - start) /
+							SDL_GetPerformanceFrequency();
+	}
+	SDL_FreeSurface(head);
+	IMG_Quit();
+	SDL_Quit();
+	if (nFrames == 0) {
+		std::cout << "Unable to write " << output << '\n';
+		return 1;
+	}
+
+	std::cout << "Exported " << nFrames << " frames of a replay scoring "
+						<< replay.getScore() << " to " << output << " in " << elapsed
+						<< " s, " << nFrames / elapsed << " frames/s with "
+						<< nRasterizers << " rasterizer(s) and " << nEncoders
+						<< " encoder(s)\n";
+	return 0;
+}
@@ -0,0 +1,268 @@
+#ifndef FIXED_SNAKE_GAME_HH
+#define FIXED_SNAKE_GAME_HH
+
+#include <array>
+#include <SDL2/SDL.h>
+#include <utility>
+
+#include "GameTypes.hh"
+
+/**
+ * Cell reached by moving from each cell of a Rows x Cols grid in each
+ * direction, -1 if the move leaves the grid
+ */
+template <int Rows, int Cols>
+constexpr std::array<std::array<int, NONE>, Rows * Cols> fixedNeighbors() {
+	std::array<std::array<int, NONE>, Rows * Cols> neighbors = {};
+	for (int cell = 0; cell < Rows * Cols; cell++) {
+		int r = cell / Cols;
+		int c = cell % Cols;
+		neighbors[cell][DOWN] = r + 1 < Rows ? cell + Cols : -1;
+		neighbors[cell][LEFT] = c > 0 ? cell - 1 : -1;
+		neighbors[cell][UP] = r > 0 ? cell - Cols : -1;
+		neighbors[cell][RIGHT] = c + 1 < Cols ? cell + 1 : -1;
+	}
+	return neighbors;
+}
+
+/**
+ * Bounds mask of each cell of a Rows x Cols grid, bit d is set if moving in
+ * direction d stays on the grid
+ */
+template <int Rows, int Cols>
+constexpr std::array<Uint8, Rows * Cols> fixedExits() {
+	std::array<std::array<int, NONE>, Rows * Cols> neighbors =
+			fixedNeighbors<Rows, Cols>();
+	std::array<Uint8, Rows * Cols> exits = {};
+	for (int cell = 0; cell < Rows * Cols; cell++) {
+		for (int d = 0; d < NONE; d++) {
+			if (neighbors[cell][d] >= 0) {
+				exits[cell] |= 1 << d;
+			}
+		}
+	}
+	return exits;
+}
+
+/**
+ * Snake game with its grid size fixed at compile time
+ * All storage lives in std::arrays inside the object and neighbors are read
+ * from constexpr tables, so playing never touches the heap. Given the same
+ * seed and inputs it places apples and ends games exactly like SnakeGame.
+ * Games whose size is only known at run time use SnakeGame instead.
+ */
+template <int Rows, int Cols>
+class FixedSnakeGame {
+	public:
+		static constexpr int CELLS = Rows * Cols;
+
+		FixedSnakeGame();
+		void init(int, Uint64);
+		bool setDirection(Direction);
+		bool move();
+
+		// Getters
+		bool isPlaying() const;
+		Uint64 getScore() const;
+		static constexpr int getRows() { return Rows; }
+		static constexpr int getCols() { return Cols; }
+		std::pair<int, int> getHead() const;
+		Direction getDirection() const;
+		Spaces getCell(int, int) const;
+
+	private:
+		static constexpr std::array<std::array<int, NONE>, CELLS> NEIGHBORS =
+				fixedNeighbors<Rows, Cols>();
+		static constexpr std::array<Uint8, CELLS> EXITS = fixedExits<Rows, Cols>();
+
+		std::array<Spaces, CELLS> _grid;
+
+		// Ring buffer of the body from the tail to the cell behind the head
+		std::array<int, CELLS> _path;
+		int _pathStart;
+		int _pathLength;
+
+		// Free cells for placing apples and the position of each in _freeCells
+		std::array<int, CELLS> _freeCells;
+		std::array<int, CELLS> _freeIndex;
+		int _nFree;
+
+		int _head;
+		Direction _direction;
+		Uint64 _score;
+		bool _playing;
+		Uint64 _rngState;
+
+		bool placeApple();
+		Uint64 nextRandom();
+		void addFreeSpace(int);
+		void deleteFreeSpace(int);
+};
+
+template <int Rows, int Cols>
+FixedSnakeGame<Rows, Cols>::FixedSnakeGame() {
+	_grid.fill(BLANK);
+	_pathStart = 0;
+	_pathLength = 0;
+	_nFree = 0;
+	_head = -1;
+	_direction = NONE;
+	_score = 0;
+	_playing = false;
+	_rngState = 0;
+}
+
+/**
+ * Get the game ready to begin, matching SnakeGame::init
+ * @param numApples Number of apples initially placed on the board
+ * @param seed Initial state of the generator used to place apples
+ */
+template <int Rows, int Cols>
+void FixedSnakeGame<Rows, Cols>::init(int numApples, Uint64 seed) {
+	_rngState = seed;
+	_pathStart = 0;
+	_pathLength = 0;
+	_direction = NONE;
+	for (int cell = 0; cell < CELLS; cell++) {
+		_grid[cell] = BLANK;
+		_freeCells[cell] = cell;
+		_freeIndex[cell] = cell;
+	}
+	_nFree = CELLS;
+	_head = (Rows / 2) * Cols + Cols / 2;
+	_grid[_head] = HEAD;
+	deleteFreeSpace(_head);
+	for (int i = 0; i < numApples; i++) {
+		placeApple();
+	}
+	_score = 1;
+	_playing = true;
+}
+
+/**
+ * Change the direction the snake is moving
+ * Do not allow the snake to move back into itself
+ * @param direction The new direction of the snake
+ * @return Whether the direction was changed
+ */
+template <int Rows, int Cols>
+bool FixedSnakeGame<Rows, Cols>::setDirection(Direction direction) {
+	if (!_playing || direction == NONE) {
+		return false;
+	}
+	// Off-grid moves are always allowed here, they end the game in move()
+	if (_pathLength > 0 && (EXITS[_head] & (1 << direction)) &&
+			NEIGHBORS[_head][direction] ==
+					_path[(_pathStart + _pathLength - 1) % CELLS]) {
+		return false;
+	}
+	_direction = direction;
+	return true;
+}
+
+/**
+ * Move the snake one cell in its current direction, matching SnakeGame::move
+ * @return True if the game continues, false if the game is over
+ */
+template <int Rows, int Cols>
+bool FixedSnakeGame<Rows, Cols>::move() {
+	if (!_playing || _direction == NONE) {
+		return true;
+	}
+	_grid[_head] = BODY;
+	_path[(_pathStart + _pathLength) % CELLS] = _head;
+	_pathLength++;
+
+	if (!(EXITS[_head] & (1 << _direction))) { // Out of bounds
+		_playing = false;
+		return false;
+	}
+	_head = NEIGHBORS[_head][_direction];
+	Spaces currSpace = _grid[_head];
+
+	if (currSpace == BODY) { // Ran into itself
+		_playing = false;
+		return false;
+	} else if (currSpace == BLANK) { // Clear last cell
+		int last = _path[_pathStart];
+		_pathStart = (_pathStart + 1) % CELLS;
+		_pathLength--;
+		_grid[last] = BLANK;
+		addFreeSpace(last);
+		deleteFreeSpace(_head);
+	} else if (currSpace == APPLE) { // Increase score/length of snake
+		_score++;
+		if (!placeApple()) {
+			_playing = false;
+			return false;
+		}
+	}
+
+	_grid[_head] = HEAD;
+	return true;
+}
+
+// Place an apple at a randomly selected blank space
+template <int Rows, int Cols>
+bool FixedSnakeGame<Rows, Cols>::placeApple() {
+	if (_nFree == 0) {
+		return false;
+	}
+	int cell = _freeCells[nextRandom() % _nFree];
+	_grid[cell] = APPLE;
+	deleteFreeSpace(cell);
+	return true;
+}
+
+// Advance the apple generator (splitmix64) and return its next value
+template <int Rows, int Cols>
+Uint64 FixedSnakeGame<Rows, Cols>::nextRandom() {
+	Uint64 z = (_rngState += 0x9e3779b97f4a7c15ULL);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+template <int Rows, int Cols>
+void FixedSnakeGame<Rows, Cols>::addFreeSpace(int cell) {
+	_freeIndex[cell] = _nFree;
+	_freeCells[_nFree++] = cell;
+}
+
+// Remove a cell from the free list by moving the last free cell into its place
+template <int Rows, int Cols>
+void FixedSnakeGame<Rows, Cols>::deleteFreeSpace(int cell) {
+	int index = _freeIndex[cell];
+	int last = _freeCells[--_nFree];
+	_freeCells[index] = last;
+	_freeIndex[last] = index;
+}
+
+// Getters
+
+template <int Rows, int Cols>
+bool FixedSnakeGame<Rows, Cols>::isPlaying() const {
+	return _playing;
+}
+
+template <int Rows, int Cols>
+Uint64 FixedSnakeGame<Rows, Cols>::getScore() const {
+	return _score;
+}
+
+template <int Rows, int Cols>
+std::pair<int, int> FixedSnakeGame<Rows, Cols>::getHead() const {
+	return std::pair(_head / Cols, _head % Cols);
+}
+
+template <int Rows, int Cols>
+Direction FixedSnakeGame<Rows, Cols>::getDirection() const {
+	return _direction;
+}
+
+template <int Rows, int Cols>
+Spaces FixedSnakeGame<Rows, Cols>::getCell(int r, int c) const {
+	return _grid[r * Cols + c];
+}
+
+#endif
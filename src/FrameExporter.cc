@@ -0,0 +1,229 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "BoundedQueue.hh"
+#include "FrameExporter.hh"
+#include "GridRasterizer.hh"
+#include "Replay.hh"
+#include "SnakeGame.hh"
+#include "Trace.hh"
+
+// Frames in flight for every worker thread, so each stage has work queued
+#define FRAMES_PER_WORKER (2)
+
+// Encoding takes much longer than drawing, one rasterizer per this many threads
+#define THREADS_PER_RASTERIZER (4)
+
+/**
+ * Make the frames every replay is drawn into
+ * @param dimension Width and height of the frames in pixels
+ * @param head Image drawn for the head, rotated to the direction it moves
+ 							 like in Main, NULL draws a green cell instead
+ * @param nThreads Number of threads drawing and encoding frames, besides the
+ 									 one playing the replay. 0 uses one thread per core.
+ */
+FrameExporter::FrameExporter(int dimension, SDL_Surface* head, int nThreads) {
+	if (nThreads <= 0) {
+		nThreads = std::thread::hardware_concurrency();
+	}
+	_dimension = dimension;
+	_nRasterizers = std::max(1, nThreads / THREADS_PER_RASTERIZER);
+	_nEncoders = std::max(1, nThreads - _nRasterizers);
+	_format = RAW_FRAMES;
+	_rawFd = -1;
+	_failed = false;
+
+	int nFrames = FRAMES_PER_WORKER * (_nRasterizers + _nEncoders);
+	for (int i = 0; i < nFrames; i++) {
+		Frame frame = {0, NULL, NULL, NULL, NULL, NULL};
+		frame.surface = SDL_CreateRGBSurfaceWithFormat(0, dimension, dimension, 32,
+																									 SDL_PIXELFORMAT_ARGB8888);
+		if (frame.surface != NULL) {
+			frame.renderer = SDL_CreateSoftwareRenderer(frame.surface);
+		}
+		if (frame.renderer != NULL && head != NULL) {
+			frame.head = SDL_CreateTextureFromSurface(frame.renderer, head);
+		}
+		if (frame.renderer == NULL) {
+			SDL_FreeSurface(frame.surface);
+			break;
+		}
+		// Rasterizers already run in parallel, so each frame is drawn by one thread
+		frame.rasterizer = new GridRasterizer(frame.renderer, 1);
+		frame.game = new SnakeGame(frame.renderer, frame.head);
+		frame.game->setRasterizer(frame.rasterizer);
+		_frames.push_back(frame);
+	}
+}
+
+FrameExporter::~FrameExporter() {
+	for (Frame& frame : _frames) {
+		delete frame.game;
+		delete frame.rasterizer;
+		if (frame.head != NULL) {
+			SDL_DestroyTexture(frame.head);
+		}
+		SDL_DestroyRenderer(frame.renderer);
+		SDL_FreeSurface(frame.surface);
+	}
+}
+
+/**
+ * Draw every tick of a replay and write the frames
+ * @param replay The replay, its first frame is the game as it starts and the
+ 								 last is the final move before the round ended
+ * @param output Directory the PNGs are written to, made if needed, or the
+ 								 file the raw frames are written to
+ * @param format How the frames are written
+ * @return Number of frames written, 0 if they could not all be written
+ */
+Uint64 FrameExporter::exportReplay(const Replay& replay,
+																	 const std::string& output,
+																	 FrameFormat format) {
+	if (_frames.empty()) {
+		return 0;
+	}
+	_format = format;
+	_output = output;
+	_failed = false;
+	if (format == PNG_FRAMES) {
+		if (mkdir(output.c_str(), 0755) != 0 && errno != EEXIST) {
+			return 0;
+		}
+	} else {
+		_rawFd = open(output.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (_rawFd < 0) {
+			return 0;
+		}
+	}
+
+	// Frames go around from idle to drawing to encoding and back to idle
+	BoundedQueue<Frame*> idle(_frames.size());
+	BoundedQueue<Frame*> drawing(_frames.size());
+	BoundedQueue<Frame*> encoding(_frames.size());
+	for (Frame& frame : _frames) {
+		idle.push(&frame);
+	}
+	std::vector<std::thread> rasterizers;
+	for (int i = 0; i < _nRasterizers; i++) {
+		rasterizers.emplace_back(&FrameExporter::rasterize, this, &drawing,
+														 &encoding);
+	}
+	std::vector<std::thread> encoders;
+	for (int i = 0; i < _nEncoders; i++) {
+		encoders.emplace_back(&FrameExporter::encode, this, &encoding, &idle);
+	}
+
+	// Drawing a game that is over shows nothing, so the tick that ends the
+	// round gets no frame
+	Uint64 nFrames = 0;
+	SnakeGame game;
+	replay.play(&game, [&](const SnakeGame& tick) {
+		Frame* frame;
+		if (!tick.isPlaying() || _failed || !idle.pop(&frame)) {
+			return;
+		}
+		tick.clone(*frame->game);
+		frame->index = nFrames++;
+		drawing.push(frame);
+	});
+
+	drawing.close();
+	for (std::thread& thread : rasterizers) {
+		thread.join();
+	}
+	encoding.close();
+	for (std::thread& thread : encoders) {
+		thread.join();
+	}
+	if (_rawFd >= 0) {
+		if (close(_rawFd) != 0) {
+			_failed = true;
+		}
+		_rawFd = -1;
+	}
+	return _failed ? 0 : nFrames;
+}
+
+/**
+ * Loop run by each rasterizer, drawing frames like Main draws the game
+ * @param drawing Frames to draw
+ * @param encoding Where drawn frames are passed on
+ */
+void FrameExporter::rasterize(BoundedQueue<Frame*>* drawing,
+															BoundedQueue<Frame*>* encoding) {
+	Frame* frame;
+	while (drawing->pop(&frame)) {
+		TraceScope trace("rasterize", "frame", frame->index);
+		SDL_SetRenderDrawColor(frame->renderer, 0xff, 0xff, 0xff, 0xff);
+		SDL_RenderClear(frame->renderer);
+		frame->game->render();
+		SDL_RenderFlush(frame->renderer);
+		encoding->push(frame);
+	}
+}
+
+/**
+ * Loop run by each encoder, writing frames and handing them back to be reused
+ * @param encoding Frames to write
+ * @param idle Where written frames are returned
+ */
+void FrameExporter::encode(BoundedQueue<Frame*>* encoding,
+													 BoundedQueue<Frame*>* idle) {
+	Frame* frame;
+	while (encoding->pop(&frame)) {
+		TraceScope trace("encode", "frame", frame->index);
+		if (!_failed && !writeFrame(*frame)) {
+			_failed = true;
+		}
+		idle->push(frame);
+	}
+}
+
+/**
+ * Write one frame where the format puts it, frames can be written in any
+ * order since each has its own file or its own part of the raw file
+ * @param frame The frame
+ * @return Whether it was written
+ */
+bool FrameExporter::writeFrame(const Frame& frame) {
+	if (_format == PNG_FRAMES) {
+		char name[32];
+		snprintf(name, sizeof name, "/frame-%06llu.png",
+						 (unsigned long long) frame.index);
+		return IMG_SavePNG(frame.surface, (_output + name).c_str()) == 0;
+	}
+	size_t rowBytes = (size_t) _dimension * 4;
+	off_t offset = (off_t) frame.index * rowBytes * _dimension;
+	const Uint8* pixels = (const Uint8*) frame.surface->pixels;
+	if (frame.surface->pitch == (int) rowBytes) {
+		return pwrite(_rawFd, pixels, rowBytes * _dimension, offset) ==
+					 (ssize_t) (rowBytes * _dimension);
+	}
+	for (int row = 0; row < _dimension; row++) {
+		if (pwrite(_rawFd, pixels + row * frame.surface->pitch, rowBytes,
+							 offset + row * rowBytes) != (ssize_t) rowBytes) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Getters
+
+int FrameExporter::getRasterizerCount() const {
+	return _nRasterizers;
+}
+
+int FrameExporter::getEncoderCount() const {
+	return _nEncoders;
+}
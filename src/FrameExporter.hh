@@ -0,0 +1,71 @@
+#ifndef FRAME_EXPORTER_HH
+#define FRAME_EXPORTER_HH
+
+#include <atomic>
+#include <SDL2/SDL.h>
+#include <string>
+#include <vector>
+
+#include "BoundedQueue.hh"
+#include "GridRasterizer.hh"
+#include "Replay.hh"
+#include "SnakeGame.hh"
+
+// How the frames of a replay are written
+enum FrameFormat {
+	PNG_FRAMES, // One PNG per frame in a directory
+	RAW_FRAMES  // Every frame in one file as rows of 32-bit BGRA pixels
+};
+
+/**
+ * Turns replays into video frames without a window
+ * The replay is played on the calling thread while rasterizer threads draw
+ * each tick with SDL's software renderer and encoder threads write the
+ * frames. Ticks are drawn as SnakeGame::render draws them in Main without a
+ * GPU, except that a head image with transparent pixels shows the green cell
+ * beneath it instead of the background. The stages are joined by bounded
+ * queues, so only a fixed set of frames is ever in flight.
+ */
+class FrameExporter {
+	public:
+		FrameExporter(int, SDL_Surface*, int = 0);
+		~FrameExporter();
+		FrameExporter(const FrameExporter&) = delete;
+		FrameExporter& operator=(const FrameExporter&) = delete;
+		Uint64 exportReplay(const Replay&, const std::string&, FrameFormat);
+
+		// Getters
+		int getRasterizerCount() const;
+		int getEncoderCount() const;
+
+	private:
+		// A surface with its own renderer, and a game drawn by that renderer
+		// through a single threaded rasterizer
+		struct Frame {
+			Uint64 index;
+			SDL_Surface* surface;
+			SDL_Renderer* renderer;
+			SDL_Texture* head;
+			GridRasterizer* rasterizer;
+			SnakeGame* game;
+		};
+
+		// Width and height of every frame in pixels
+		int _dimension;
+		int _nRasterizers;
+		int _nEncoders;
+
+		std::vector<Frame> _frames;
+
+		// Where the current replay is written
+		FrameFormat _format;
+		std::string _output;
+		int _rawFd;
+		std::atomic<bool> _failed;
+
+		void rasterize(BoundedQueue<Frame*>*, BoundedQueue<Frame*>*);
+		void encode(BoundedQueue<Frame*>*, BoundedQueue<Frame*>*);
+		bool writeFrame(const Frame&);
+};
+
+#endif
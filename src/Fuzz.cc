@@ -0,0 +1,83 @@
+#include <cstdlib>
+#include <iostream>
+#include <SDL2/SDL.h>
+#include <string>
+#include <vector>
+
+#include "DifferentialFuzzer.hh"
+
+#define CASE_FLAG ("--case")
+#define CASES_PER_ROUND (4096)
+#define DEFAULT_FUZZ_SECONDS (10)
+#define DEFAULT_FUZZ_SEED (2024)
+
+// Show a disagreement and the case that caused it
+void printMismatch(const FuzzCase& fuzzCase, const FuzzMismatch& mismatch) {
+	std::cout << "FAIL: " << mismatch.variant << " disagreed with SnakeGame after "
+						<< mismatch.tick << " of " << fuzzCase.ticks.size()
+						<< " ticks: " << mismatch.detail << '\n';
+}
+
+/**
+ * Check that every engine variant plays exactly like SnakeGame by playing
+ * seeded random games on all of them in lockstep, and shrink the first
+ * disagreement to a small case that can be played again with --case
+ * Usage: Fuzz [seconds] [seed] [threads]
+ *        Fuzz --case rows cols apples seed ticks
+ */
+int main(int argc, char* argv[]) {
+	if (argc > 1 && std::string(argv[1]) == CASE_FLAG) {
+		FuzzCase fuzzCase;
+		if (!DifferentialFuzzer::parse(std::vector<std::string>(argv + 2,
+																														argv + argc),
+																	 &fuzzCase)) {
+			std::cout << "Usage: " << argv[0] << ' ' << CASE_FLAG
+								<< " rows cols apples seed ticks\n";
+			return 1;
+		}
+		DifferentialFuzzer fuzzer(0, 1);
+		FuzzMismatch mismatch;
+		if (!fuzzer.check(fuzzCase, &mismatch)) {
+			printMismatch(fuzzCase, mismatch);
+			return 1;
+		}
+		std::cout << "Every variant agrees over " << fuzzer.getTickCount()
+							<< " ticks\n";
+		return 0;
+	}
+
+	double seconds = argc > 1 ? atof(argv[1]) : DEFAULT_FUZZ_SECONDS;
+	Uint64 seed = argc > 2 ? strtoull(argv[2], NULL, 10) : DEFAULT_FUZZ_SEED;
+	int nThreads = argc > 3 ? atoi(argv[3]) : 0;
+	if (seconds <= 0 || nThreads < 0) {
+		std::cout << "Usage: " << argv[0] << " [seconds] [seed] [threads]\n";
+		return 1;
+	}
+
+	DifferentialFuzzer fuzzer(seed, nThreads);
+	FuzzCase fuzzCase;
+	FuzzMismatch mismatch;
+	bool agreed = true;
+	Uint64 start = SDL_GetPerformanceCounter();
+	double elapsed = 0;
+	while (agreed && elapsed < seconds) {
+		agreed = fuzzer.run(CASES_PER_ROUND, &fuzzCase, &mismatch);
+		elapsed = (double) (SDL_GetPerformanceCounter() - start) /
+							SDL_GetPerformanceFrequency();
+	}
+	std::cout << "Checked " << fuzzer.getCaseCount() << " cases, "
+						<< fuzzer.getTickCount() << " ticks in " << elapsed << " s, "
+						<< fuzzer.getTickCount() / elapsed << " ticks/s on "
+						<< fuzzer.getThreadCount() << " thread(s)\n";
+	if (agreed) {
+		return 0;
+	}
+
+	printMismatch(fuzzCase, mismatch);
+	fuzzer.shrink(&fuzzCase, &mismatch);
+	std::cout << "Shrunk to " << fuzzCase.ticks.size() << " ticks: ";
+	printMismatch(fuzzCase, mismatch);
+	std::cout << "Play it again with: " << argv[0] << ' ' << CASE_FLAG << ' '
+						<< DifferentialFuzzer::format(fuzzCase) << '\n';
+	return 1;
+}
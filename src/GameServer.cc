@@ -0,0 +1,477 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <SDL2/SDL.h>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+#include "GameServer.hh"
+#include "Rollout.hh"
+#include "SnakeGame.hh"
+#include "Trace.hh"
+
+// Events handled per call to epoll_wait
+#define MAX_EVENTS (256)
+#define RECEIVE_BUFFER_SIZE (4096)
+
+// Ticks the end of a round stays on screen before the next one starts
+#define RESTART_TICKS (20)
+
+/**
+ * Append a number to a message as little-endian bytes
+ * @param out Message to append to
+ * @param value Number to write
+ * @param nBytes How many of its low bytes to write
+ */
+static void putNumber(std::vector<Uint8>* out, Uint64 value, int nBytes) {
+	for (int i = 0; i < nBytes; i++) {
+		out->push_back(value >> (8 * i));
+	}
+}
+
+/**
+ * Describe the events epoll should report for a socket
+ * @param fd The socket
+ * @param events Events to report
+ */
+static struct epoll_event watchFor(int fd, Uint32 events) {
+	struct epoll_event event;
+	event.events = events;
+	event.data.fd = fd;
+	return event;
+}
+
+// Write a message's type and leave room for its length, filled in by endMessage
+static void beginMessage(std::vector<Uint8>* out, MessageType type) {
+	out->clear();
+	out->push_back(type);
+	putNumber(out, 0, 4);
+}
+
+static void endMessage(std::vector<Uint8>* out) {
+	Uint32 length = out->size() - MESSAGE_HEADER_SIZE;
+	for (int i = 0; i < 4; i++) {
+		(*out)[1 + i] = length >> (8 * i);
+	}
+}
+
+// Append the row, column and contents of each cell to a message
+static void putCells(std::vector<Uint8>* out,
+										 const std::vector<CellChange>& cells) {
+	putNumber(out, cells.size(), 4);
+	for (const CellChange& cell : cells) {
+		putNumber(out, (Uint32) cell.row, 4);
+		putNumber(out, (Uint32) cell.col, 4);
+		out->push_back(cell.value);
+	}
+}
+
+// The server is closed until open is called
+GameServer::GameServer() {
+	_listenFd = -1;
+	_epollFd = -1;
+	_timerFd = -1;
+	_stopping = false;
+	memset(&_settings, 0, sizeof _settings);
+	_seed = 0;
+	_ticks = 0;
+	_overTicks = 0;
+	_input = NONE;
+	_autoplay = false;
+	_rng = 0;
+	_bytesSent = 0;
+	_game.enableChangeLog(true);
+}
+
+GameServer::~GameServer() {
+	close();
+}
+
+/**
+ * Start a game and listen for clients on a Unix domain socket
+ * @param path Path of the socket, anything already there is replaced
+ * @param settings Settings every round is played with
+ * @param seed Seed of the first round, each later round uses the next one
+ * @return Whether the socket could be opened
+ */
+bool GameServer::open(const std::string& path, const RoundSettings& settings,
+											Uint64 seed) {
+	close();
+	struct sockaddr_un address;
+	if (path.size() >= sizeof address.sun_path) {
+		return false;
+	}
+	memset(&address, 0, sizeof address);
+	address.sun_family = AF_UNIX;
+	memcpy(address.sun_path, path.c_str(), path.size());
+	unlink(path.c_str());
+
+	_listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	_epollFd = epoll_create1(EPOLL_CLOEXEC);
+	_timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (_listenFd < 0 || _epollFd < 0 || _timerFd < 0 ||
+			bind(_listenFd, (struct sockaddr*) &address, sizeof address) != 0) {
+		close();
+		return false;
+	}
+	_path = path;
+	struct epoll_event listenEvent = watchFor(_listenFd, EPOLLIN);
+	struct epoll_event timerEvent = watchFor(_timerFd, EPOLLIN);
+	if (listen(_listenFd, SOMAXCONN) != 0 ||
+			epoll_ctl(_epollFd, EPOLL_CTL_ADD, _listenFd, &listenEvent) != 0 ||
+			epoll_ctl(_epollFd, EPOLL_CTL_ADD, _timerFd, &timerEvent) != 0) {
+		close();
+		return false;
+	}
+
+	_settings = settings;
+	_seed = seed;
+	_rng = seed;
+	_stopping = false;
+	startRound();
+	return true;
+}
+
+// Disconnect every client and remove the socket
+void GameServer::close() {
+	for (const std::pair<const int, Client>& entry : _clients) {
+		::close(entry.first);
+	}
+	_clients.clear();
+	for (int* fd : {&_listenFd, &_epollFd, &_timerFd}) {
+		if (*fd >= 0) {
+			::close(*fd);
+			*fd = -1;
+		}
+	}
+	if (!_path.empty()) {
+		unlink(_path.c_str());
+		_path.clear();
+	}
+}
+
+/**
+ * Tick the game and serve clients until stop is called
+ * Each tick waits as long as a round in Main would, getting shorter by the
+ * acceleration for every apple eaten
+ */
+void GameServer::run() {
+	struct epoll_event events[MAX_EVENTS];
+	struct itimerspec delay;
+	memset(&delay, 0, sizeof delay);
+	while (!_stopping) {
+		if (!delay.it_value.tv_sec && !delay.it_value.tv_nsec) {
+			Uint64 ms = 1000 / 60; // Same pace as the game over screen in Main
+			Uint64 speedUp = _settings.acceleration * (_game.getScore() - 1);
+			if (_game.isPlaying() && _settings.timeDelay > speedUp) {
+				ms = std::max((Uint64) 1, _settings.timeDelay - speedUp);
+			}
+			delay.it_value.tv_sec = ms / 1000;
+			delay.it_value.tv_nsec = ms % 1000 * 1000000;
+			timerfd_settime(_timerFd, 0, &delay, NULL);
+		}
+
+		int nEvents = epoll_wait(_epollFd, events, MAX_EVENTS, -1);
+		if (nEvents < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			break;
+		}
+		for (int i = 0; i < nEvents; i++) {
+			int fd = events[i].data.fd;
+			if (fd == _listenFd) {
+				acceptClients();
+			} else if (fd == _timerFd) {
+				Uint64 expirations;
+				if (read(_timerFd, &expirations, sizeof expirations) > 0) {
+					tick();
+					memset(&delay, 0, sizeof delay);
+				}
+			} else {
+				std::unordered_map<int, Client>::iterator it = _clients.find(fd);
+				if (it == _clients.end()) {
+					continue;
+				}
+				if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+					receive(fd);
+				}
+				if (events[i].events & EPOLLOUT) {
+					flush(fd, it->second);
+				}
+			}
+		}
+		closeClients();
+	}
+}
+
+// Make run return, safe to call from a signal handler
+void GameServer::stop() {
+	_stopping = true;
+}
+
+/**
+ * Choose whether the server steers the snake on ticks no client sent a
+ * direction, so there is always something to watch
+ * @param autoplay Whether the server steers
+ */
+void GameServer::setAutoplay(bool autoplay) {
+	_autoplay = autoplay;
+}
+
+/**
+ * Serve a connected socket as a client, sending it a keyframe
+ * @param fd Socket of the client, closed by the server when it leaves
+ * @return Whether the client was added
+ */
+bool GameServer::addClient(int fd) {
+	int flags = fcntl(fd, F_GETFL);
+	struct epoll_event event = watchFor(fd, EPOLLIN);
+	if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) != 0 ||
+			(_epollFd >= 0 &&
+			 epoll_ctl(_epollFd, EPOLL_CTL_ADD, fd, &event) != 0)) {
+		::close(fd);
+		return false;
+	}
+	Client& client = _clients[fd];
+	client.outStart = 0;
+	client.waitingToSend = false;
+	encodeKeyframe();
+	send(fd, client, _message.data(), _message.size());
+	closeClients();
+	return true;
+}
+
+/**
+ * Advance the game by one tick and send every client what changed
+ * Once a round is over the next one starts after RESTART_TICKS ticks
+ */
+void GameServer::tick() {
+	TraceScope trace("serverTick", "clients", _clients.size());
+	_ticks++;
+	if (!_game.isPlaying()) {
+		if (++_overTicks >= RESTART_TICKS) {
+			startRound();
+		}
+		return;
+	}
+	if (_input != NONE) {
+		_game.setDirection(_input);
+	} else if (_autoplay) {
+		_game.setDirection(RolloutEvaluator::choose(_game, HEURISTIC_POLICY, &_rng));
+	}
+	_input = NONE;
+	_game.move();
+	encodeDelta();
+	_game.clearChanges();
+	broadcast(_message);
+}
+
+// Start a new round and send every client its keyframe
+void GameServer::startRound() {
+	_game.init(_settings.rows, _settings.cols, _settings.apples, _seed++);
+	_game.clearChanges();
+	_overTicks = 0;
+	_input = NONE;
+	encodeKeyframe();
+	broadcast(_message);
+}
+
+// Accept every client waiting to connect
+void GameServer::acceptClients() {
+	while (true) {
+		int fd = accept4(_listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (fd < 0) {
+			return;
+		}
+		addClient(fd);
+	}
+}
+
+/**
+ * Read what a client sent and act on every whole message in it
+ * A client that closed its end or sent a malformed message is disconnected
+ * @param fd Socket of the client
+ */
+void GameServer::receive(int fd) {
+	Client& client = _clients[fd];
+	Uint8 buffer[RECEIVE_BUFFER_SIZE];
+	while (true) {
+		ssize_t received = recv(fd, buffer, sizeof buffer, 0);
+		if (received == 0 || (received < 0 && errno != EAGAIN &&
+													errno != EWOULDBLOCK && errno != EINTR)) {
+			_closing.push_back(fd);
+			return;
+		}
+		if (received < 0) {
+			break;
+		}
+		client.in.insert(client.in.end(), buffer, buffer + received);
+	}
+
+	size_t start = 0;
+	while (client.in.size() - start >= MESSAGE_HEADER_SIZE) {
+		const Uint8* message = client.in.data() + start;
+		Uint32 length = message[1] | message[2] << 8 | message[3] << 16 |
+										(Uint32) message[4] << 24;
+		if (message[0] != INPUT_MESSAGE || length != 1) {
+			_closing.push_back(fd);
+			return;
+		}
+		if (client.in.size() - start < MESSAGE_HEADER_SIZE + length) {
+			break;
+		}
+		if (message[MESSAGE_HEADER_SIZE] >= NONE) {
+			_closing.push_back(fd);
+			return;
+		}
+		_input = (Direction) message[MESSAGE_HEADER_SIZE];
+		start += MESSAGE_HEADER_SIZE + length;
+	}
+	client.in.erase(client.in.begin(), client.in.begin() + start);
+}
+
+/**
+ * Send bytes to a client, keeping whatever the socket does not accept yet
+ * A client that is still more than MAX_CLIENT_BACKLOG bytes behind when
+ * another message comes is disconnected, the size of the message itself
+ * does not count so large keyframes can always be sent
+ * @param fd Socket of the client
+ * @param client The client
+ * @param data, size Bytes to send
+ */
+void GameServer::send(int fd, Client& client, const Uint8* data, size_t size) {
+	if (client.out.size() - client.outStart > MAX_CLIENT_BACKLOG) {
+		_closing.push_back(fd);
+		return;
+	}
+	if (client.out.size() == client.outStart) {
+		ssize_t sent = ::send(fd, data, size, MSG_NOSIGNAL);
+		if (sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+			_closing.push_back(fd);
+			return;
+		}
+		sent = std::max((ssize_t) 0, sent);
+		_bytesSent += sent;
+		data += sent;
+		size -= sent;
+		if (size == 0) {
+			return;
+		}
+	}
+	client.out.insert(client.out.end(), data, data + size);
+	watchOutput(fd, client, true);
+}
+
+// Send as much of a client's backlog as its socket accepts
+void GameServer::flush(int fd, Client& client) {
+	while (client.outStart < client.out.size()) {
+		ssize_t sent = ::send(fd, client.out.data() + client.outStart,
+													client.out.size() - client.outStart, MSG_NOSIGNAL);
+		if (sent < 0) {
+			if (errno != EAGAIN && errno != EWOULDBLOCK) {
+				_closing.push_back(fd);
+			}
+			break;
+		}
+		_bytesSent += sent;
+		client.outStart += sent;
+	}
+	if (client.outStart == client.out.size()) {
+		client.out.clear();
+		client.outStart = 0;
+		watchOutput(fd, client, false);
+	} else if (client.outStart > client.out.size() / 2) {
+		client.out.erase(client.out.begin(), client.out.begin() + client.outStart);
+		client.outStart = 0;
+	}
+}
+
+/**
+ * Choose whether the loop wakes up when a client's socket accepts more bytes
+ * @param fd Socket of the client
+ * @param client The client
+ * @param waiting Whether it should
+ */
+void GameServer::watchOutput(int fd, Client& client, bool waiting) {
+	if (client.waitingToSend == waiting || _epollFd < 0) {
+		return;
+	}
+	struct epoll_event event = watchFor(fd, EPOLLIN | (waiting ? EPOLLOUT : 0));
+	epoll_ctl(_epollFd, EPOLL_CTL_MOD, fd, &event);
+	client.waitingToSend = waiting;
+}
+
+// Send the same message to every client
+void GameServer::broadcast(const std::vector<Uint8>& message) {
+	for (std::pair<const int, Client>& entry : _clients) {
+		send(entry.first, entry.second, message.data(), message.size());
+	}
+	closeClients();
+}
+
+// Disconnect the clients marked as closing
+void GameServer::closeClients() {
+	for (int fd : _closing) {
+		if (_clients.erase(fd) > 0) {
+			::close(fd);
+		}
+	}
+	_closing.clear();
+}
+
+// Write the state of the game as a keyframe, the message a client joining now
+// is sent
+void GameServer::encodeKeyframe() {
+	beginMessage(&_message, KEYFRAME_MESSAGE);
+	putNumber(&_message, _ticks, 8);
+	putNumber(&_message, _game.getScore(), 8);
+	putNumber(&_message, _game.getRows(), 4);
+	putNumber(&_message, _game.getCols(), 4);
+	putNumber(&_message, (Uint32) _game.getHead().first, 4);
+	putNumber(&_message, (Uint32) _game.getHead().second, 4);
+	_message.push_back(_game.getDirection());
+	_message.push_back(_game.isPlaying());
+	_cells.clear();
+	_game.listCells(&_cells);
+	putCells(&_message, _cells);
+	endMessage(&_message);
+}
+
+// Write the changes of the last tick as a delta
+void GameServer::encodeDelta() {
+	beginMessage(&_message, DELTA_MESSAGE);
+	putNumber(&_message, _ticks, 8);
+	putNumber(&_message, _game.getScore(), 8);
+	putNumber(&_message, (Uint32) _game.getHead().first, 4);
+	putNumber(&_message, (Uint32) _game.getHead().second, 4);
+	_message.push_back(_game.getDirection());
+	_message.push_back(_game.isPlaying());
+	putCells(&_message, _game.getChanges());
+	endMessage(&_message);
+}
+
+// Getters
+
+size_t GameServer::getClientCount() const {
+	return _clients.size();
+}
+
+Uint64 GameServer::getTicks() const {
+	return _ticks;
+}
+
+Uint64 GameServer::getBytesSent() const {
+	return _bytesSent;
+}
+
+const SnakeGame& GameServer::getGame() const {
+	return _game;
+}
@@ -0,0 +1,125 @@
+#ifndef GAME_SERVER_HH
+#define GAME_SERVER_HH
+
+#include <atomic>
+#include <SDL2/SDL.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "GameTypes.hh"
+#include "SnakeGame.hh"
+
+// Every message starts with its type as one byte and the length of the rest
+// of the message as four little-endian bytes. All numbers are little-endian.
+#define MESSAGE_HEADER_SIZE (5)
+
+// Bytes a client may fall behind by before it is disconnected, a message is
+// always queued whole so one larger than this still reaches a client that
+// has caught up
+#define MAX_CLIENT_BACKLOG (1 << 20)
+
+// Most bytes a message can hold after its header, and the bytes a keyframe
+// takes before its cells and for each cell
+#define MAX_MESSAGE_LENGTH (0xffffffffULL)
+#define KEYFRAME_FIXED_BYTES (38)
+#define KEYFRAME_CELL_BYTES (9)
+
+enum MessageType : Uint8 {
+	// Server to client, the whole state of the game, sent when a client joins
+	// and when a new round starts:
+	//   tick (8), score (8), rows (4), cols (4), head row (4), head col (4),
+	//   direction (1), playing (1), cell count (4), then for each cell that is
+	//   not blank its row (4), col (4) and contents (1)
+	KEYFRAME_MESSAGE,
+
+	// Server to client, what changed during one tick:
+	//   tick (8), score (8), head row (4), head col (4), direction (1),
+	//   playing (1), change count (4), then for each changed cell its row (4),
+	//   col (4) and new contents (1), in the order they changed
+	DELTA_MESSAGE,
+
+	// Client to server, a direction (1) to turn the snake on the next tick
+	INPUT_MESSAGE
+};
+
+/**
+ * Authoritative host of one game that local clients watch and steer through a
+ * Unix domain socket
+ * Clients are sent a keyframe when they join and a delta after every tick,
+ * so what is sent each tick depends on how many cells changed and not on the
+ * size of the grid. Every client is served by a single epoll loop.
+ */
+class GameServer {
+	public:
+		GameServer();
+		~GameServer();
+		bool open(const std::string&, const RoundSettings&, Uint64);
+		void close();
+		void run();
+		void stop();
+		void setAutoplay(bool);
+		bool addClient(int);
+		void tick();
+
+		// Getters
+		size_t getClientCount() const;
+		Uint64 getTicks() const;
+		Uint64 getBytesSent() const;
+		const SnakeGame& getGame() const;
+
+	private:
+		struct Client {
+			// Bytes not sent yet, from outStart on
+			std::vector<Uint8> out;
+			size_t outStart;
+
+			// Bytes received that do not make a whole message yet
+			std::vector<Uint8> in;
+
+			// Whether the loop is waiting for the socket to accept more bytes
+			bool waitingToSend;
+		};
+
+		std::string _path;
+		int _listenFd;
+		int _epollFd;
+		int _timerFd;
+		std::atomic<bool> _stopping;
+
+		std::unordered_map<int, Client> _clients;
+		std::vector<int> _closing;
+
+		SnakeGame _game;
+		RoundSettings _settings;
+		Uint64 _seed;
+		Uint64 _ticks;
+		Uint64 _overTicks; // Ticks since the round ended
+
+		// Direction sent by a client since the last tick, NONE if there is none
+		Direction _input;
+
+		// Whether the server steers the snake on ticks no client sent a direction
+		bool _autoplay;
+		Uint64 _rng;
+
+		// Messages being built and the cells listed for keyframes, reused
+		// every tick
+		std::vector<Uint8> _message;
+		std::vector<CellChange> _cells;
+
+		Uint64 _bytesSent;
+
+		void startRound();
+		void acceptClients();
+		void receive(int);
+		void send(int, Client&, const Uint8*, size_t);
+		void flush(int, Client&);
+		void watchOutput(int, Client&, bool);
+		void broadcast(const std::vector<Uint8>&);
+		void closeClients();
+		void encodeKeyframe();
+		void encodeDelta();
+};
+
+#endif
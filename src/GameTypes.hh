@@ -0,0 +1,38 @@
+#ifndef GAME_TYPES_HH
+#define GAME_TYPES_HH
+
+#include <SDL2/SDL.h>
+
+enum Spaces : Uint8 {
+	HEAD,
+	BODY,
+	APPLE,
+	BLANK
+};
+
+enum Direction {
+	DOWN,
+	LEFT,
+	UP,
+	RIGHT,
+	NONE
+};
+
+// A cell of the grid and what it now holds
+struct CellChange {
+	Sint32 row;
+	Sint32 col;
+	Spaces value;
+};
+
+// Settings a round was played with, as stored in files
+struct RoundSettings {
+	Uint32 rows;
+	Uint32 cols;
+	Uint32 apples;
+	Uint32 padding;
+	Uint64 timeDelay;
+	Uint64 acceleration;
+};
+
+#endif
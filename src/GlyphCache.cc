@@ -0,0 +1,314 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include "Checksum.hh"
+#include "GlyphCache.hh"
+
+// Offset of the first byte covered by the checksum
+#define CHECKSUM_START (offsetof(GlyphCacheHeader, checksum) + sizeof(Uint64))
+
+// Nothing is mapped until open or build is called
+GlyphCache::GlyphCache() {
+	_map = NULL;
+	_mapSize = 0;
+	_header = NULL;
+	_atlas = NULL;
+}
+
+GlyphCache::~GlyphCache() {
+	close();
+}
+
+/**
+ * Map a cache file and check that it was built from the font being used
+ * Only the font file's bytes are read, the font itself is never opened
+ * @param path Path of the cache file
+ * @param fontPath Path of the font file the cache should have been built from
+ * @param pointSize Size the font should have been drawn at
+ * @return Whether the cache is intact and matches the font, nothing is mapped
+ 					 if it does not
+ */
+bool GlyphCache::open(const std::string& path, const std::string& fontPath,
+											int pointSize) {
+	close();
+	Uint64 fontHash;
+	Uint64 fontBytes;
+	if (!hashFont(fontPath, &fontHash, &fontBytes)) {
+		return false;
+	}
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	struct stat info;
+	if (fstat(fd, &info) != 0 ||
+			(size_t) info.st_size < sizeof(GlyphCacheHeader)) {
+		::close(fd);
+		return false;
+	}
+	void* map = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (map == MAP_FAILED) {
+		return false;
+	}
+	_map = map;
+	_mapSize = info.st_size;
+
+	const GlyphCacheHeader* header = (const GlyphCacheHeader*) map;
+	bool valid = header->magic == GLYPH_CACHE_MAGIC &&
+							 header->version == GLYPH_CACHE_VERSION &&
+							 header->fontHash == fontHash &&
+							 header->fontBytes == fontBytes &&
+							 header->pointSize == pointSize && header->height > 0 &&
+							 header->atlasWidth >= 0 &&
+							 _mapSize == sizeof(GlyphCacheHeader) +
+													 (size_t) header->atlasWidth * header->height &&
+							 header->checksum == checksum((const Uint8*) map +
+																						CHECKSUM_START,
+																						_mapSize - CHECKSUM_START);
+	for (int g = 0; valid && g < TOTAL_GLYPHS; g++) {
+		const GlyphInfo& glyph = header->glyphs[g];
+		valid = glyph.x >= 0 && glyph.width >= 0 && glyph.advance >= 0 &&
+						glyph.x + glyph.width <= header->atlasWidth;
+	}
+	if (!valid) {
+		close();
+		return false;
+	}
+	_header = header;
+	_atlas = (const Uint8*) map + sizeof(GlyphCacheHeader);
+	return true;
+}
+
+/**
+ * Draw every character of a font with SDL_ttf, write them to a cache file
+ * and map it as open does
+ * The file is replaced at once so a crash never leaves half of one behind
+ * @param font The font, opened at pointSize
+ * @param path Path of the cache file, which is overwritten
+ * @param fontPath Path of the file the font was opened from
+ * @param pointSize Size the font was opened at
+ * @return Whether the cache was written and mapped
+ */
+bool GlyphCache::build(TTF_Font* font, const std::string& path,
+											 const std::string& fontPath, int pointSize) {
+	close();
+	GlyphCacheHeader header = {};
+	if (font == NULL ||
+			!hashFont(fontPath, &header.fontHash, &header.fontBytes)) {
+		return false;
+	}
+	header.magic = GLYPH_CACHE_MAGIC;
+	header.version = GLYPH_CACHE_VERSION;
+	header.pointSize = pointSize;
+	header.height = TTF_FontHeight(font);
+
+	// Each character is drawn on its own so it lands where SDL_ttf puts it in
+	// a line, relative to where the pen was
+	SDL_Color white = {0xff, 0xff, 0xff, 0xff};
+	std::vector<SDL_Surface*> drawn(TOTAL_GLYPHS, NULL);
+	bool success = header.height > 0;
+	for (int g = 0; success && g < TOTAL_GLYPHS; g++) {
+		char text[] = {(char) (FIRST_GLYPH + g), '\0'};
+		int minX, maxX, minY, maxY, advance;
+		success = TTF_GlyphMetrics(font, text[0], &minX, &maxX, &minY, &maxY,
+															 &advance) == 0;
+		// Characters that draw nothing, like spaces, only move the pen
+		drawn[g] = TTF_RenderText_Solid(font, text, white);
+		if (drawn[g] != NULL && drawn[g]->format->BytesPerPixel != 1) {
+			success = false;
+		}
+		header.glyphs[g].x = header.atlasWidth;
+		header.glyphs[g].width = drawn[g] != NULL ? drawn[g]->w : 0;
+		header.glyphs[g].advance = std::max(advance, 0);
+		header.atlasWidth += header.glyphs[g].width;
+		for (int next = 0; next < TOTAL_GLYPHS; next++) {
+			int kerning = TTF_GetFontKerningSizeGlyphs(font, text[0],
+																								 FIRST_GLYPH + next);
+			header.kerning[g][next] = std::clamp(kerning, -128, 127);
+		}
+	}
+
+	size_t size = sizeof header + (size_t) header.atlasWidth * header.height;
+	std::string tempPath = path + ".tmp";
+	int fd = -1;
+	if (success) {
+		fd = ::open(tempPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+		success = fd >= 0 && ftruncate(fd, size) == 0;
+	}
+	void* map = MAP_FAILED;
+	if (success) {
+		map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		success = map != MAP_FAILED;
+	}
+	if (fd >= 0) {
+		::close(fd);
+	}
+
+	if (success) {
+		// Solid text uses pixel 0 for the background and 1 for the text
+		Uint8* bytes = (Uint8*) map;
+		Uint8* atlas = bytes + sizeof header;
+		for (int g = 0; g < TOTAL_GLYPHS; g++) {
+			if (drawn[g] == NULL) {
+				continue;
+			}
+			int rows = std::min(drawn[g]->h, header.height);
+			for (int y = 0; y < rows; y++) {
+				const Uint8* source = (const Uint8*) drawn[g]->pixels +
+															y * drawn[g]->pitch;
+				Uint8* target = atlas + (size_t) y * header.atlasWidth +
+												header.glyphs[g].x;
+				for (int x = 0; x < drawn[g]->w; x++) {
+					target[x] = source[x] != 0;
+				}
+			}
+		}
+		memcpy(bytes, &header, sizeof header);
+		header.checksum = checksum(bytes + CHECKSUM_START, size - CHECKSUM_START);
+		memcpy(bytes + offsetof(GlyphCacheHeader, checksum), &header.checksum,
+					 sizeof header.checksum);
+		success = munmap(map, size) == 0 &&
+							rename(tempPath.c_str(), path.c_str()) == 0;
+	}
+	for (SDL_Surface* surface : drawn) {
+		SDL_FreeSurface(surface);
+	}
+	return success && open(path, fontPath, pointSize);
+}
+
+// Unmap the cache, surfaces drawn from it stay valid
+void GlyphCache::close() {
+	if (_map != NULL) {
+		munmap(_map, _mapSize);
+	}
+	_map = NULL;
+	_mapSize = 0;
+	_header = NULL;
+	_atlas = NULL;
+}
+
+/**
+ * Check that every character of a line of text can be drawn from the cache
+ * @param text The line
+ * @return Whether the cache is open and holds every character
+ */
+bool GlyphCache::covers(const std::string& text) const {
+	if (_header == NULL) {
+		return false;
+	}
+	for (char c : text) {
+		if (c < FIRST_GLYPH || c > LAST_GLYPH) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * Draw a line of text from the cached characters into a surface laid out like
+ * the one TTF_RenderText_Solid returns, without touching the font
+ * @param text The line, every character of which must be covered
+ * @param color Color of the text
+ * @return The surface, which the caller frees, or NULL if the line is empty
+ 					 or a surface could not be created
+ */
+SDL_Surface* GlyphCache::renderText(const std::string& text,
+																		SDL_Color color) const {
+	// Lay the characters out first to find the width of the line
+	int width = 0;
+	int pen = 0;
+	for (size_t i = 0; i < text.size(); i++) {
+		int g = text[i] - FIRST_GLYPH;
+		if (i > 0) {
+			pen = std::max(pen + _header->kerning[text[i - 1] - FIRST_GLYPH][g], 0);
+		}
+		width = std::max(width, pen + _header->glyphs[g].width);
+		pen += _header->glyphs[g].advance;
+	}
+	if (width == 0) {
+		SDL_SetError("Text has zero width");
+		return NULL;
+	}
+
+	SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, width,
+																												_header->height, 8,
+																												SDL_PIXELFORMAT_INDEX8);
+	if (surface == NULL) {
+		return NULL;
+	}
+	SDL_Color colors[] = {{(Uint8) (0xff - color.r), (Uint8) (0xff - color.g),
+												 (Uint8) (0xff - color.b), 0}, color};
+	SDL_SetPaletteColors(surface->format->palette, colors, 0, 2);
+	SDL_SetColorKey(surface, SDL_TRUE, 0);
+
+	// Characters can overlap once kerned, so their pixels are combined
+	Uint8* pixels = (Uint8*) surface->pixels;
+	pen = 0;
+	for (size_t i = 0; i < text.size(); i++) {
+		int g = text[i] - FIRST_GLYPH;
+		if (i > 0) {
+			pen = std::max(pen + _header->kerning[text[i - 1] - FIRST_GLYPH][g], 0);
+		}
+		const GlyphInfo& glyph = _header->glyphs[g];
+		for (int y = 0; y < _header->height; y++) {
+			const Uint8* source = _atlas + (size_t) y * _header->atlasWidth +
+														glyph.x;
+			Uint8* target = pixels + y * surface->pitch + pen;
+			for (int x = 0; x < glyph.width; x++) {
+				target[x] |= source[x];
+			}
+		}
+		pen += glyph.advance;
+	}
+	return surface;
+}
+
+/**
+ * Checksum a font file without parsing it
+ * @param path Path of the font file
+ * @param hash Where its checksum is stored
+ * @param bytes Where its size is stored
+ * @return Whether the file could be read
+ */
+bool GlyphCache::hashFont(const std::string& path, Uint64* hash,
+													Uint64* bytes) {
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size == 0) {
+		::close(fd);
+		return false;
+	}
+	void* map = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (map == MAP_FAILED) {
+		return false;
+	}
+	*hash = checksum(map, info.st_size);
+	*bytes = info.st_size;
+	munmap(map, info.st_size);
+	return true;
+}
+
+// Getters
+
+bool GlyphCache::isOpen() const {
+	return _header != NULL;
+}
+
+int GlyphCache::getHeight() const {
+	return _header != NULL ? _header->height : 0;
+}
@@ -0,0 +1,77 @@
+#ifndef GLYPH_CACHE_HH
+#define GLYPH_CACHE_HH
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <string>
+
+#define GLYPH_CACHE_MAGIC (0x48504c47) // "GLPH"
+#define GLYPH_CACHE_VERSION (1)
+
+// Characters kept in the cache, every printable ASCII character
+#define FIRST_GLYPH (' ')
+#define LAST_GLYPH ('~')
+#define TOTAL_GLYPHS (LAST_GLYPH - FIRST_GLYPH + 1)
+
+// Where a character's pixels are in the atlas and how far it moves the pen
+struct GlyphInfo {
+	Sint32 x;       // First column of the character in the atlas
+	Sint32 width;   // Columns it covers, as SDL_ttf draws it on its own
+	Sint32 advance; // Distance from its start to the next character's
+	Sint32 padding;
+};
+
+// Start of a cache file, followed by the atlas: one byte per pixel, 1 where
+// the text is drawn, row after row
+struct GlyphCacheHeader {
+	Uint32 magic;
+	Uint32 version;
+	Uint64 fontHash;  // Checksum of the font file the glyphs were drawn from
+	Uint64 fontBytes; // Size of that file
+	Uint64 checksum;  // Of everything after this field, the atlas included
+	Sint32 pointSize;
+	Sint32 height;     // Height of a line, and of the atlas
+	Sint32 atlasWidth;
+	Sint32 padding;
+	GlyphInfo glyphs[TOTAL_GLYPHS];
+	Sint8 kerning[TOTAL_GLYPHS][TOTAL_GLYPHS]; // Added between two characters
+};
+
+/**
+ * Every printable ASCII character of a font at one size, drawn once by
+ * SDL_ttf and kept in a memory-mapped file so later launches can draw text
+ * without opening the font
+ * The file is tied to the font file by its size and checksum, so changing
+ * the font makes it stale instead of wrong. Lines are drawn by copying each
+ * character's pixels into a paletted surface like the one
+ * TTF_RenderText_Solid returns.
+ */
+class GlyphCache {
+	public:
+		GlyphCache();
+		~GlyphCache();
+		GlyphCache(const GlyphCache&) = delete;
+		GlyphCache& operator=(const GlyphCache&) = delete;
+		bool open(const std::string&, const std::string&, int);
+		bool build(TTF_Font*, const std::string&, const std::string&, int);
+		void close();
+		bool covers(const std::string&) const;
+		SDL_Surface* renderText(const std::string&, SDL_Color) const;
+
+		// Getters
+		bool isOpen() const;
+		int getHeight() const;
+
+	private:
+		// Mapping of the cache file
+		void* _map;
+		size_t _mapSize;
+
+		// Parts of the mapping
+		const GlyphCacheHeader* _header;
+		const Uint8* _atlas;
+
+		static bool hashFont(const std::string&, Uint64*, Uint64*);
+};
+
+#endif
@@ -0,0 +1,216 @@
+#include <algorithm>
+#include <cstring>
+#include <SDL2/SDL.h>
+#include <vector>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "Camera.hh"
+#include "GridRasterizer.hh"
+#include "Metrics.hh"
+#include "SnakeGame.hh"
+#include "Trace.hh"
+
+// Colors SnakeGame::render draws with, as ARGB pixels
+#define APPLE_PIXEL (0xffff0000)
+#define SNAKE_PIXEL (0xff00ff00)
+#define BLANK_PIXEL (0xff000000)
+#define OUTLINE_PIXEL (0xff808080)
+
+// Bands of rows per thread, so threads that finish early can take another
+#define BANDS_PER_THREAD (2)
+
+/**
+ * Fill a span of pixels with one color, four pixels per store where SSE2 is
+ * available
+ * @param dest First pixel of the span
+ * @param n Number of pixels
+ * @param color Color of every pixel
+ */
+static inline void fillSpan(Uint32* dest, int n, Uint32 color) {
+	int i = 0;
+#ifdef __SSE2__
+	__m128i wide = _mm_set1_epi32(color);
+	for (; i + 8 <= n; i += 8) {
+		_mm_storeu_si128((__m128i*) (dest + i), wide);
+		_mm_storeu_si128((__m128i*) (dest + i + 4), wide);
+	}
+	for (; i + 4 <= n; i += 4) {
+		_mm_storeu_si128((__m128i*) (dest + i), wide);
+	}
+#endif
+	for (; i < n; i++) {
+		dest[i] = color;
+	}
+}
+
+// Pixel of the inside of a cell
+static inline Uint32 cellPixel(Spaces space) {
+	switch (space) {
+		case APPLE:
+			return APPLE_PIXEL;
+		case BODY:
+		case HEAD:
+			return SNAKE_PIXEL;
+		default:
+			return BLANK_PIXEL;
+	}
+}
+
+/**
+ * Make a rasterizer drawing for a renderer
+ * @param renderer Renderer frames are uploaded to and drawn with
+ * @param nThreads Number of threads drawing, 0 uses one thread per core
+ */
+GridRasterizer::GridRasterizer(SDL_Renderer* renderer, int nThreads)
+	: _pool(nThreads) {
+	_renderer = renderer;
+	_texture = NULL;
+	_width = 0;
+	_height = 0;
+	_patterns.resize(_pool.getThreadCount());
+}
+
+GridRasterizer::~GridRasterizer() {
+	if (_texture != NULL) {
+		SDL_DestroyTexture(_texture);
+	}
+}
+
+/**
+ * Draw the visible cells of a game and copy them to the renderer, looking
+ * exactly like drawing each cell with SDL_RenderFillRect and outlining it
+ * with SDL_RenderDrawRect
+ * @param game The game
+ * @param view The part of the grid shown and where
+ * @param viewport Area of the window being drawn to
+ * @return Whether the frame was drawn, false if no texture could be made
+ */
+bool GridRasterizer::draw(const SnakeGame& game, const CameraView& view,
+													const SDL_Rect& viewport) {
+	TraceScope trace("rasterizeGrid");
+	// Cells at the edges may be partly outside the viewport, only the pixels
+	// inside it are drawn
+	int left = view.originX + view.firstCol * view.cellWidth;
+	int top = view.originY + view.firstRow * view.cellHeight;
+	SDL_Rect area;
+	area.x = std::max(0, left);
+	area.y = std::max(0, top);
+	area.w = std::min(viewport.w, view.originX + view.endCol * view.cellWidth) -
+					 area.x;
+	area.h = std::min(viewport.h, view.originY + view.endRow * view.cellHeight) -
+					 area.y;
+	if (area.w <= 0 || area.h <= 0) {
+		return true;
+	}
+	if (!resize(area.w, area.h)) {
+		return false;
+	}
+
+	int nRows = view.endRow - view.firstRow;
+	int nBands = std::min(nRows, _pool.getThreadCount() * BANDS_PER_THREAD);
+	_pool.run(nBands, [&](int band, int worker) {
+		drawRows(game, view, area, view.firstRow + nRows * band / nBands,
+						 view.firstRow + nRows * (band + 1) / nBands, &_patterns[worker]);
+	});
+
+	Metrics::add(DRAW_CALLS_COUNTER);
+	return SDL_UpdateTexture(_texture, NULL, _pixels.data(),
+													 _width * sizeof(Uint32)) == 0 &&
+				 SDL_RenderCopy(_renderer, _texture, NULL, &area) == 0;
+}
+
+/**
+ * Size the framebuffer and texture for a frame, they are only remade when
+ * the size changes
+ * @param width, height Size of the frame in pixels
+ * @return Whether the texture could be made
+ */
+bool GridRasterizer::resize(int width, int height) {
+	if (_texture != NULL && width == _width && height == _height) {
+		return true;
+	}
+	if (_texture != NULL) {
+		SDL_DestroyTexture(_texture);
+	}
+	_texture = SDL_CreateTexture(_renderer, SDL_PIXELFORMAT_ARGB8888,
+															 SDL_TEXTUREACCESS_STREAMING, width, height);
+	if (_texture == NULL) {
+		_width = 0;
+		_height = 0;
+		return false;
+	}
+	_pixels.resize((size_t) width * height);
+	_width = width;
+	_height = height;
+	return true;
+}
+
+/**
+ * Draw some rows of cells into the framebuffer
+ * @param game The game
+ * @param view The part of the grid shown and where
+ * @param area Part of the viewport the framebuffer covers
+ * @param firstRow, endRow Rows of cells [firstRow, endRow) to draw
+ * @param pattern Buffer the inside rows of each row of cells are built in
+ */
+void GridRasterizer::drawRows(const SnakeGame& game, const CameraView& view,
+															const SDL_Rect& area, int firstRow, int endRow,
+															std::vector<Uint32>* pattern) {
+	int cellWidth = view.cellWidth;
+	int cellHeight = view.cellHeight;
+	int left = view.originX + view.firstCol * cellWidth;
+	pattern->resize((size_t) (view.endCol - view.firstCol) * cellWidth);
+	const Uint32* visible = pattern->data() + (area.x - left);
+
+	for (int r = firstRow; r < endRow; r++) {
+		int cellTop = view.originY + r * cellHeight;
+		int firstY = std::max(cellTop, area.y);
+		int endY = std::min(cellTop + cellHeight, area.y + area.h);
+		if (firstY >= endY) {
+			continue;
+		}
+
+		// Inside rows have an outline pixel at each edge of every cell
+		if (cellHeight > 2 && cellWidth > 2) {
+			Uint32* dest = pattern->data();
+			for (int c = view.firstCol; c < view.endCol; c++) {
+				dest[0] = OUTLINE_PIXEL;
+				fillSpan(dest + 1, cellWidth - 2, cellPixel(game.getCell(r, c)));
+				dest[cellWidth - 1] = OUTLINE_PIXEL;
+				dest += cellWidth;
+			}
+		}
+
+		for (int y = firstY; y < endY; y++) {
+			Uint32* row = _pixels.data() + (size_t) (y - area.y) * _width;
+			int cellY = y - cellTop;
+			// Top and bottom rows are all outline, as are cells too small to
+			// have an inside
+			if (cellY == 0 || cellY == cellHeight - 1 || cellWidth <= 2) {
+				fillSpan(row, _width, OUTLINE_PIXEL);
+			} else {
+				memcpy(row, visible, _width * sizeof(Uint32));
+			}
+		}
+	}
+}
+
+// Getters
+
+const Uint32* GridRasterizer::getPixels() const {
+	return _pixels.data();
+}
+
+int GridRasterizer::getWidth() const {
+	return _width;
+}
+
+int GridRasterizer::getHeight() const {
+	return _height;
+}
+
+int GridRasterizer::getThreadCount() const {
+	return _pool.getThreadCount();
+}
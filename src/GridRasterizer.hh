@@ -0,0 +1,55 @@
+#ifndef GRID_RASTERIZER_HH
+#define GRID_RASTERIZER_HH
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+#include "Camera.hh"
+#include "WorkerPool.hh"
+
+class SnakeGame;
+
+/**
+ * Draws the cells of a grid and their outlines into a framebuffer on the CPU
+ * and uploads it as one texture per frame, for renderers without a GPU where
+ * drawing every cell through SDL is slow
+ * Rows of cells are split across threads. Every pixel row inside a row of
+ * cells is the same, so it is filled once with wide stores and then copied.
+ */
+class GridRasterizer {
+	public:
+		GridRasterizer(SDL_Renderer*, int = 0);
+		~GridRasterizer();
+		GridRasterizer(const GridRasterizer&) = delete;
+		GridRasterizer& operator=(const GridRasterizer&) = delete;
+		bool draw(const SnakeGame&, const CameraView&, const SDL_Rect&);
+
+		// Getters
+		const Uint32* getPixels() const;
+		int getWidth() const;
+		int getHeight() const;
+		int getThreadCount() const;
+
+	private:
+		SDL_Renderer* _renderer;
+
+		// Streaming texture the framebuffer is uploaded to, the same size
+		SDL_Texture* _texture;
+
+		// Framebuffer of the last frame as 32-bit ARGB pixels, covering only the
+		// part of the viewport the visible cells fall in
+		std::vector<Uint32> _pixels;
+		int _width;
+		int _height;
+
+		// Inside rows of the row of cells each worker is drawing
+		std::vector<std::vector<Uint32>> _patterns;
+
+		WorkerPool _pool;
+
+		bool resize(int, int);
+		void drawRows(const SnakeGame&, const CameraView&, const SDL_Rect&, int,
+									int, std::vector<Uint32>*);
+};
+
+#endif
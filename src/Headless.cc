@@ -0,0 +1,146 @@
+#include <cstdlib>
+#include <iostream>
+#include <SDL2/SDL.h>
+#include <vector>
+
+#include "AllocationCounter.hh"
+#include "Replay.hh"
+#include "ReplayArchive.hh"
+#include "Rollout.hh"
+#include "SnakeGame.hh"
+
+#define ARCHIVE_CHECKS (10)
+#define DEFAULT_APPLES (3)
+#define DEFAULT_GRID_DIMENSION (20)
+#define DEFAULT_ROUNDS (1000)
+#define HEADLESS_SEED (2024)
+#define MAX_ROUND_TICKS (100000)
+
+/**
+ * Check an archive written by this program by playing back its best rounds
+ * @param path Path of the archive
+ * @param settings Settings every round was played with
+ * @return Whether every round played back to its recorded score
+ */
+bool checkArchive(const char* path, const RoundSettings& settings) {
+	ReplayArchive archive;
+	if (!archive.open(path)) {
+		std::cout << "Unable to open " << path << '\n';
+		return false;
+	}
+	std::vector<const ArchiveEntry*> best;
+	archive.topScores(settings, ARCHIVE_CHECKS, &best);
+	SnakeGame game;
+	Replay replay;
+	for (const ArchiveEntry* entry : best) {
+		if (!archive.load(*entry, &replay) || !replay.play(&game)) {
+			std::cout << "FAIL: a replay scoring " << entry->score
+								<< " did not play back to its score\n";
+			return false;
+		}
+	}
+	std::cout << "archived " << archive.getCount() << " replays, best score "
+						<< (best.empty() ? 0 : best[0]->score) << ", the best "
+						<< best.size() << " play back to their scores\n";
+	return true;
+}
+
+/**
+ * Play rounds of the game without a window, steered by the heuristic
+ * playout policy, and check that once the first round has sized the game's
+ * storage no tick, init or reset allocates
+ * Given an archive path, every round's replay is also packed into an archive,
+ * which allocates as the replays grow so allocations are not checked
+ * Usage: Headless [rows] [cols] [apples] [rounds] [archive]
+ */
+int main(int argc, char* argv[]) {
+	int nRows = argc > 1 ? atoi(argv[1]) : DEFAULT_GRID_DIMENSION;
+	int nCols = argc > 2 ? atoi(argv[2]) : DEFAULT_GRID_DIMENSION;
+	int numApples = argc > 3 ? atoi(argv[3]) : DEFAULT_APPLES;
+	int rounds = argc > 4 ? atoi(argv[4]) : DEFAULT_ROUNDS;
+	const char* archivePath = argc > 5 ? argv[5] : NULL;
+	if (nRows < 1 || nCols < 1 || numApples < 1 || rounds < 1 ||
+			(Uint64) nRows * nCols <= (Uint64) numApples) {
+		std::cout << "Usage: " << argv[0]
+							<< " [rows] [cols] [apples] [rounds] [archive]\n";
+		return 1;
+	}
+	ReplayArchiveWriter archive;
+	if (archivePath != NULL && !archive.open(archivePath)) {
+		std::cout << "Unable to create " << archivePath << '\n';
+		return 1;
+	}
+	RoundSettings settings = {(Uint32) nRows, (Uint32) nCols, (Uint32) numApples,
+														0, 0, 0};
+	Replay replay;
+	// Chunks of huge boards are allocated as the snake reaches them
+	bool dense = (Uint64) nRows * nCols <= SPARSE_THRESHOLD;
+
+	SnakeGame game;
+	Uint64 rng = HEADLESS_SEED;
+	Uint64 ticks = 0;
+	Uint64 totalScore = 0;
+	Uint64 warmUpAllocations = 0;
+	Uint64 initAllocations = 0;
+	Uint64 tickAllocations = 0;
+	Uint64 resetAllocations = 0;
+
+	Uint64 start = SDL_GetPerformanceCounter();
+	for (int round = 0; round < rounds; round++) {
+		Uint64 before = getAllocationCount();
+		game.init(nRows, nCols, numApples, HEADLESS_SEED + round);
+		replay.start(settings, HEADLESS_SEED + round);
+		Uint64 allocations = getAllocationCount() - before;
+		if (round == 0) { // The first round sizes the storage
+			warmUpAllocations += allocations;
+		} else {
+			initAllocations += allocations;
+		}
+
+		for (int tick = 0; tick < MAX_ROUND_TICKS; tick++) {
+			before = getAllocationCount();
+			game.setDirection(RolloutEvaluator::choose(game, HEURISTIC_POLICY, &rng));
+			if (archivePath != NULL) {
+				replay.recordTick(game.getDirection());
+			}
+			bool playing = game.move();
+			tickAllocations += getAllocationCount() - before;
+			ticks++;
+			if (!playing) {
+				break;
+			}
+		}
+		totalScore += game.getScore();
+		if (archivePath != NULL) {
+			replay.finish(game.getScore());
+			archive.add(replay);
+		}
+
+		before = getAllocationCount();
+		game.reset();
+		resetAllocations += getAllocationCount() - before;
+	}
+	double elapsed = (double) (SDL_GetPerformanceCounter() - start) /
+									 SDL_GetPerformanceFrequency();
+	if (archivePath != NULL && !archive.finish()) {
+		std::cout << "Unable to write " << archivePath << '\n';
+		return 1;
+	}
+
+	std::cout << rounds << " rounds on " << nRows << 'x' << nCols << " with "
+						<< numApples << " apple(s): " << ticks << " ticks, mean score "
+						<< (double) totalScore / rounds << ", " << ticks / elapsed
+						<< " ticks/s\n"
+						<< "allocations: " << warmUpAllocations << " sizing storage, "
+						<< initAllocations << " in later inits, " << tickAllocations
+						<< " in ticks, " << resetAllocations << " in resets\n";
+
+	if (archivePath != NULL) {
+		return checkArchive(archivePath, settings) ? 0 : 1;
+	}
+	if (dense && initAllocations + tickAllocations + resetAllocations > 0) {
+		std::cout << "FAIL: the game allocated after its storage was sized\n";
+		return 1;
+	}
+	return 0;
+}
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <iostream>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
@@ -5,20 +6,45 @@
 #include <sstream>
 #include <string>
 
+#include "Camera.hh"
+#include "GlyphCache.hh"
+#include "GridRasterizer.hh"
+#include "Metrics.hh"
+#include "Profiler.hh"
 #include "SnakeGame.hh"
+#include "Snapshot.hh"
+#include "StatsStore.hh"
 #include "TextDisplay.hh"
+#include "Trace.hh"
 
+#define AUTOSAVE_TICKS (5000)
+#define FONT_PATH ("fonts/BebasNeue-Regular.ttf")
 #define FONT_SIZE (25)
+#define GLYPH_CACHE_PATH ("glyphs.bin")
 #define INIT_ACCELERATION (0)
 #define INIT_APPLES (1)
 #define INIT_GRID_DIMENSION (10)
 #define INIT_SCREEN_DIMENSION (800)
 #define INIT_TIME_DELAY (150)
-#define INSTRUCTION_LINES (10)
-#define MAX_HEIGHT (100)
-#define MAX_WIDTH (100)
+#define INSTRUCTION_LINES (11)
+#define LATE_TICK_MS (5)
+// Largest grid the menu offers, bigger grids are kept dense and would make
+// starting a round and copying the game for each autosave stall the window
+#define MAX_HEIGHT (1000)
+#define MAX_WIDTH (1000)
+#define METRICS_FLAG ("--metrics")
+#define METRICS_INTERVAL_MS (1000)
+#define METRICS_SOCKET_FLAG ("--metrics-socket")
 #define PRESET_TILE_MULT (80)
+#define PROFILE_FLAG ("--profile")
+#define PROFILE_PATH ("profile.csv")
+#define PROFILE_REFRESH_TICKS (500)
+#define SNAPSHOT_PATH ("snapshot.bin")
+#define STATS_INDEX_PATH ("stats.idx")
+#define STATS_LOG_PATH ("stats.log")
 #define TICKS_FOR_60_FPS (1000 / 60)
+#define TRACE_FLAG ("--trace")
+#define TRACE_PATH ("trace.json")
 
 enum Data {
 	TIME_DELAY,
@@ -54,14 +80,17 @@ const SDL_Color BLACK = {0, 0, 0, 0xff};
 const SDL_Color RED = {0xff, 0, 0, 0xff};
 
 // Initialize SDL and its data structures
-bool init(SDL_Window**, SDL_Renderer**, SDL_Texture**, TTF_Font**);
+bool init(SDL_Window**, SDL_Renderer**, SDL_Texture**, TTF_Font**,
+					GlyphCache*);
 
 // Initialize the TextDisplay objects for the different attributes
 bool initializeText(TextDisplay*, TextDisplay*, TextDisplay*,
-										Uint64*, TTF_Font*, SDL_Renderer*, SDL_Window*);
+										Uint64*, TTF_Font*, const GlyphCache*, SDL_Renderer*,
+										SDL_Window*);
 
 // Set up game over data before it is rendered to the screen
-bool initializeGameOver(TextDisplay*, TextDisplay*, Uint64, Uint64*);
+bool initializeGameOver(TextDisplay*, TextDisplay*, Uint64, Uint64, Uint64*,
+												StatsStore*);
 
 // Helper methods to load game attribute text for editing/finished editing
 inline void startEditText(TextDisplay*, Uint64*, int);
@@ -71,12 +100,19 @@ inline void endEditText(TextDisplay*, Uint64*, int);
 bool checkDecrementAttribute(Uint64*, int, SDL_Window*);
 bool checkIncrementAttribute(Uint64*, int, SDL_Window*);
 
+// Resize the window so each cell of the grid is a square that fits on screen
+void resizeToGrid(SDL_Window*, const Uint64*);
+
 // Render the menu displayed before a game starts
 void renderInitialization(TextDisplay*, TextDisplay*, int);
 
 // Render the game over screen
 void renderGameOver(TextDisplay*, TextDisplay*, int, int, bool);
 
+// Reload and render the profiler overlay
+bool updateProfileText(TextDisplay*, const Profiler&);
+void renderProfile(TextDisplay*);
+
 // Free memory associated with the game, quit SDL systems
 void closeSDL(SDL_Window*, SDL_Renderer*, TTF_Font*, TextDisplay*, TextDisplay*,
 							TextDisplay*);
@@ -87,11 +123,13 @@ void closeSDL(SDL_Window*, SDL_Renderer*, TTF_Font*, TextDisplay*, TextDisplay*,
  * @param window_ptr Pointer for the SDL_Window that will be used during program
  * @param renderer_ptr Pointer for the renderer that will be used during program
  * @param texture_ptr Pointer for the texture that will display the head
- * @param font_ptr Pointer for the font that will be used during program
+ * @param font_ptr Pointer for the font that will be used during program, set
+ 										to NULL when the glyph cache is used instead
+ * @param glyphs The glyph cache, opened or built
  * @return Whether all of the initialization successfully completed
  */
 bool init(SDL_Window** window_ptr, SDL_Renderer** renderer_ptr,
-					SDL_Texture** texture_ptr, TTF_Font** font_ptr) {
+					SDL_Texture** texture_ptr, TTF_Font** font_ptr, GlyphCache* glyphs) {
 	if (SDL_Init(SDL_INIT_VIDEO) < 0) {
 		std::cout << "Unable to initialize SDL: " << SDL_GetError() << '\n';
 		return false;
@@ -106,6 +144,9 @@ bool init(SDL_Window** window_ptr, SDL_Renderer** renderer_ptr,
 	}
 
 	*renderer_ptr = SDL_CreateRenderer(*window_ptr, -1, SDL_RENDERER_ACCELERATED);
+	if (*renderer_ptr == NULL) { // No GPU, draw on the CPU instead
+		*renderer_ptr = SDL_CreateRenderer(*window_ptr, -1, SDL_RENDERER_SOFTWARE);
+	}
 	if (*renderer_ptr == NULL) {
 		std::cout << "Unable to create renderer: " << SDL_GetError() << '\n';
 		return false;
@@ -134,16 +175,27 @@ bool init(SDL_Window** window_ptr, SDL_Renderer** renderer_ptr,
 		SDL_FreeSurface(headSurface);
 	}
 
+	// Text is copied from the glyph cache, the font is only opened to build the
+	// cache when it is missing or was built from another font
+	*font_ptr = NULL;
+	if (glyphs->open(GLYPH_CACHE_PATH, FONT_PATH, FONT_SIZE)) {
+		return true;
+	}
+
 	if (TTF_Init() == -1) {
 		std::cout << "TTF Initialization Error: " << TTF_GetError() << '\n';
 		return false;
 	}
 
-	*font_ptr = TTF_OpenFont("fonts/BebasNeue-Regular.ttf", FONT_SIZE);
+	*font_ptr = TTF_OpenFont(FONT_PATH, FONT_SIZE);
 	if (*font_ptr == NULL) {
 		std::cout << "Unable to load font: " << TTF_GetError() << '\n';
 		return false;
 	}
+	if (!glyphs->build(*font_ptr, GLYPH_CACHE_PATH, FONT_PATH, FONT_SIZE)) {
+		std::cout << "Unable to write " << GLYPH_CACHE_PATH
+							<< ", text will be drawn with the font\n";
+	}
 	return true;
 }
 
@@ -155,14 +207,17 @@ bool init(SDL_Window** window_ptr, SDL_Renderer** renderer_ptr,
  * @param dataText An array of TextDisplay objects that will display each of
  									 the attributes that can be altered by the user
  * @param gameData An array containing the data that will be displayed/altered
- * @param font The font that will be used when displaying text
+ * @param font The font that will be used when displaying text, can be NULL
+ 								when the glyph cache holds every character
+ * @param glyphs Characters drawn ahead of time, used instead of the font
  * @param renderer The renderer used to render each of the text images
  * @param window Window being rendered to, some attributes will be initialized
  * @return Whether all of the text was successfully loaded or not
  */
 bool initializeText(TextDisplay* instructions_ptr, TextDisplay* dataText,
 										TextDisplay* gameOverText, Uint64* gameData,
-										TTF_Font* font, SDL_Renderer* renderer, SDL_Window* window) {
+										TTF_Font* font, const GlyphCache* glyphs,
+										SDL_Renderer* renderer, SDL_Window* window) {
 	// Initialize data array
 	gameData[TIME_DELAY] = INIT_TIME_DELAY;
 	gameData[ACCELERATION] = INIT_ACCELERATION;
@@ -172,15 +227,15 @@ bool initializeText(TextDisplay* instructions_ptr, TextDisplay* dataText,
 	gameData[HIGH_SCORE] = 0;
 
 	for (int i = 0; i < INSTRUCTION_LINES; i++) {
-		instructions_ptr[i] = TextDisplay(font, renderer);
+		instructions_ptr[i] = TextDisplay(font, renderer, glyphs);
 	}
 
 	for (int i = 0; i < TOTAL_DATA; i++) {
-		dataText[i] = TextDisplay(font, renderer);
+		dataText[i] = TextDisplay(font, renderer, glyphs);
 	}
 
 	for (int i = 0; i < TOTAL_GAME_OVER; i++) {
-		gameOverText[i] = TextDisplay(font, renderer);
+		gameOverText[i] = TextDisplay(font, renderer, glyphs);
 	}
 
 	// Load Instructions
@@ -238,6 +293,12 @@ bool initializeText(TextDisplay* instructions_ptr, TextDisplay* dataText,
 							"\"wasd\" to move");
 	success = success && instructions_ptr->loadText(currStr.str(), BLACK);
 
+	instructions_ptr++;
+
+	currStr.str("While playing, \"+\"/\"-\" zoom, \"ijkl\" pan, \"F\" follows "
+							"the snake and \"M\" toggles the map, F3 shows timings");
+	success = success && instructions_ptr->loadText(currStr.str(), BLACK);
+
 	// Initial highlighted/selected text
 	currStr.str("");
 	currStr << DATA_TEXT[TIME_DELAY] << gameData[TIME_DELAY];
@@ -264,11 +325,20 @@ bool initializeText(TextDisplay* instructions_ptr, TextDisplay* dataText,
  * @param gameOverText An array of text objects used to display to this screen
  * @param highScoreText Pointer to the object used to display the high score
  * @param recentScore The score from the previously completed round
+ * @param ticks Number of times the snake moved in the previous round
  * @param gameData an array of data related to the game's attributes
+ * @param stats Store the round is recorded in, without waiting for the disk
  * @return Whether a new high score was achieved or not
  */
 bool initializeGameOver(TextDisplay* gameOverText, TextDisplay* highScoreText,
-												Uint64 recentScore, Uint64* gameData) {
+												Uint64 recentScore, Uint64 ticks, Uint64* gameData,
+												StatsStore* stats) {
+	RoundSettings settings = {(Uint32) gameData[G_HEIGHT],
+														(Uint32) gameData[G_WIDTH],
+														(Uint32) gameData[NUM_APPLES], 0,
+														gameData[TIME_DELAY], gameData[ACCELERATION]};
+	stats->record(settings, recentScore, ticks);
+
 	std::stringstream gameOverStr;
 	gameOverStr << GAME_OVER_TEXT[LAST_SCORE] << recentScore;
 	gameOverText[LAST_SCORE].loadText(gameOverStr.str(), BLACK);
@@ -409,6 +479,27 @@ bool checkIncrementAttribute(Uint64* gameData, int index, SDL_Window* window) {
 	}
 	return false;		
 }
+
+/**
+ * Resize the window so the grid is made of PRESET_TILE_MULT pixel squares,
+ * using smaller squares when that window would not fit on its display
+ * @param window The window
+ * @param gameData Attributes of the game, only the grid size is used
+ */
+void resizeToGrid(SDL_Window* window, const Uint64* gameData) {
+	Uint64 tile = PRESET_TILE_MULT;
+	SDL_Rect bounds;
+	if (SDL_GetDisplayUsableBounds(SDL_GetWindowDisplayIndex(window),
+																 &bounds) != 0) {
+		bounds = {0, 0, INIT_SCREEN_DIMENSION, INIT_SCREEN_DIMENSION};
+	}
+	tile = std::min({tile, bounds.w / gameData[G_WIDTH],
+									 bounds.h / gameData[G_HEIGHT]});
+	// Grids with more cells than the display has pixels fill the display
+	int newWidth = tile > 0 ? tile * gameData[G_WIDTH] : bounds.w;
+	int newHeight = tile > 0 ? tile * gameData[G_HEIGHT] : bounds.h;
+	SDL_SetWindowSize(window, newWidth, newHeight);
+}
 			
 /**
  * Render the screen for setting up the game (allowing user to change
@@ -470,6 +561,34 @@ void renderGameOver(TextDisplay* gameOverText, TextDisplay* highScoreText,
 														viewport.h - gameOverText[EXIT].getHeight());
 }
 
+/**
+ * Load the latest summary of each phase into the overlay text
+ * Text is only reloaded every so often since loading it is not cheap
+ * @param profileText array of text with one line per phase
+ * @param profiler Profiler with the timings to show
+ * @return Whether all of the text was successfully loaded or not
+ */
+bool updateProfileText(TextDisplay* profileText, const Profiler& profiler) {
+	bool success = true;
+	for (int i = 0; i < TOTAL_PHASES; i++) {
+		success = success && profileText[i].loadText(profiler.describe((Phase) i),
+																								 RED);
+	}
+	return success;
+}
+
+/**
+ * Render the profiler overlay in the top left corner of the window
+ * @param profileText array of text with one line per phase
+ */
+void renderProfile(TextDisplay* profileText) {
+	int y = 0;
+	for (int i = 0; i < TOTAL_PHASES; i++) {
+		profileText[i].render(0, y);
+		y += profileText[i].getHeight();
+	}
+}
+
 /**
  * Free any existing memory and quit SDL systems
  * @param window SDL_Window to be destroyed
@@ -504,8 +623,9 @@ int main(int argc, char* argv[]) {
 	SDL_Renderer* renderer = NULL;
 	SDL_Texture* head = NULL;
 	TTF_Font* font = NULL;
+	GlyphCache glyphs;
 
-	if (!init(&window, &renderer, &head, &font)) {
+	if (!init(&window, &renderer, &head, &font, &glyphs)) {
 		return -1;
 	}
 
@@ -515,10 +635,48 @@ int main(int argc, char* argv[]) {
 	Uint64 gameData[TOTAL_DATA];
 
 	if (!initializeText(instructions, dataDisplay, gameOverDisplay, gameData,
-											font, renderer, window)) {
+											font, &glyphs, renderer, window)) {
 		return -1;
 	}
 
+	// Time each phase of the loop when asked to, write the results on exit
+	Profiler profiler;
+	bool profileToFile = false;
+	// Record a timeline of each frame that Perfetto can open
+	bool trace = false;
+	// Keep metrics in a file and on a socket for unattended machines
+	std::string metricsFile;
+	std::string metricsSocket;
+	for (int i = 1; i < argc; i++) {
+		if (std::string(argv[i]) == PROFILE_FLAG) {
+			profileToFile = true;
+			profiler.setEnabled(true);
+		} else if (std::string(argv[i]) == TRACE_FLAG) {
+			trace = true;
+			Tracer::setEnabled(true);
+		} else if (std::string(argv[i]) == METRICS_FLAG && i + 1 < argc) {
+			metricsFile = argv[++i];
+		} else if (std::string(argv[i]) == METRICS_SOCKET_FLAG && i + 1 < argc) {
+			metricsSocket = argv[++i];
+		}
+	}
+	if (!metricsFile.empty() || !metricsSocket.empty()) {
+		Metrics::setEnabled(true);
+		if (!Metrics::startExport(metricsFile, metricsSocket,
+															METRICS_INTERVAL_MS)) {
+			std::cout << "Unable to listen on " << metricsSocket << '\n';
+			if (!metricsFile.empty()) {
+				Metrics::startExport(metricsFile, "", METRICS_INTERVAL_MS);
+			}
+		}
+	}
+	TextDisplay profileDisplay[TOTAL_PHASES];
+	for (int i = 0; i < TOTAL_PHASES; i++) {
+		profileDisplay[i] = TextDisplay(font, renderer, &glyphs);
+	}
+	bool showProfile = false;
+	Uint64 profileLoadTicks = 0;
+
 	srand(SDL_GetTicks());
 
 	bool quit = false;
@@ -526,25 +684,89 @@ int main(int argc, char* argv[]) {
 
 	// Variables for the snake game and its different attributes
 	SnakeGame snakeGame = SnakeGame(renderer, head);
+	snakeGame.enableMinimap(true);
+
+	// Drawing every cell through a software renderer is slow, so without a GPU
+	// the grid is drawn into a framebuffer by several threads instead
+	GridRasterizer* rasterizer = NULL;
+	SDL_RendererInfo rendererInfo;
+	if (SDL_GetRendererInfo(renderer, &rendererInfo) == 0 &&
+			!(rendererInfo.flags & SDL_RENDERER_ACCELERATED)) {
+		rasterizer = new GridRasterizer(renderer);
+		snakeGame.setRasterizer(rasterizer);
+	}
+
+	// Decides which part of large grids is shown
+	Camera camera;
 
 	// Current piece of data being altered
 	int currIndex = 0;
 
+	// Resume the settings and any game in progress from the last time the
+	// program ran, which is saved on quit and every few seconds
+	if (loadSnapshot(SNAPSHOT_PATH, &snakeGame, gameData, TOTAL_DATA) &&
+			snakeGame.isPlaying()) {
+		SDL_SetWindowResizable(window, SDL_FALSE);
+	}
+	Uint64 saveTicks = SDL_GetTicks64();
+	SnapshotWriter autosave;
+	autosave.open(SNAPSHOT_PATH);
+
+	// Every round is recorded, the high score comes from the summary index
+	StatsStore stats;
+	if (stats.open(STATS_LOG_PATH, STATS_INDEX_PATH)) {
+		gameData[HIGH_SCORE] = std::max(gameData[HIGH_SCORE],
+																		 stats.getHighScore());
+	} else {
+		std::cout << "Unable to open " << STATS_LOG_PATH << " or "
+							<< STATS_INDEX_PATH << ", scores will not be kept\n";
+	}
+	for (int i = 0; i < TOTAL_DATA; i++) {
+		endEditText(dataDisplay, gameData, i);
+	}
+	startEditText(dataDisplay, gameData, currIndex);
+
+	// Times the snake has moved this round
+	Uint64 roundTicks = 0;
+
 	// Keep track of whether the game just finished or in initialization
 	bool gameOver = false;
 	// Note whether a new high score was achieved or not in the last round
 	bool newHigh = false;
+	// Frames since the program started, shown with each frame in traces
+	Uint64 tick = 0;
+	// When the current frame was meant to start, 0 before the first frame
+	Uint64 dueTicks = 0;
 	while (!quit) {
 		int startTicks = SDL_GetTicks64();
+		Uint64 drawCalls = Metrics::getCount(DRAW_CALLS_COUNTER);
+		if (Metrics::isEnabled() && dueTicks > 0) {
+			Sint64 drift = startTicks - (Sint64) dueTicks;
+			Metrics::set(TICK_DRIFT_GAUGE, drift);
+			if (snakeGame.isPlaying() && drift > LATE_TICK_MS) {
+				Metrics::add(LATE_TICKS_COUNTER);
+			}
+		}
+		// Turns taken this frame, only the last one before the move counts
+		int turns = 0;
+		TraceScope frameTrace("frame", "tick", tick++);
+		ScopedTimer eventsTimer(&profiler, EVENTS_PHASE);
+		TraceScope eventsTrace("events");
 		while (SDL_PollEvent(&e)) {
 			if (e.type == SDL_QUIT) {
 				quit = true;
 			} else if (e.type == SDL_KEYDOWN) {
-				if (e.key.keysym.sym == SDLK_RETURN) {
+				if (e.key.keysym.sym == SDLK_F3) { // Toggle the profiler overlay
+					showProfile = !showProfile;
+					profiler.setEnabled(showProfile || profileToFile);
+					profileLoadTicks = 0;
+				} else if (e.key.keysym.sym == SDLK_RETURN) {
 					if (!snakeGame.isPlaying() && !gameOver) { // Start game
 						SDL_SetWindowResizable(window, SDL_FALSE);
+						camera.reset();
 						snakeGame.init(gameData[G_HEIGHT], gameData[G_WIDTH],
 													 gameData[NUM_APPLES]);
+						roundTicks = 0;
 					} else if (gameOver) { // Exit game over screen
 						gameOver = false;
 					}
@@ -577,25 +799,47 @@ int main(int argc, char* argv[]) {
 						startEditText(dataDisplay, gameData, currIndex);
 					}
 				}	else if (e.key.keysym.sym == SDLK_r && !snakeGame.isPlaying() && !gameOver) {
-					int newWidth = gameData[G_WIDTH] * PRESET_TILE_MULT;
-					int newHeight = gameData[G_HEIGHT] * PRESET_TILE_MULT;
-					SDL_SetWindowSize(window, newWidth, newHeight);
+					resizeToGrid(window, gameData);
 				}
 			}
+			Direction direction = snakeGame.getDirection();
 			snakeGame.handleEvent(e);
+			turns += snakeGame.getDirection() != direction;
+			if (snakeGame.isPlaying()) {
+				camera.handleEvent(e);
+			}
+		}
+		eventsTimer.stop();
+		eventsTrace.stop();
+		if (turns > 1) {
+			Metrics::add(DROPPED_INPUTS_COUNTER, turns - 1);
 		}
-		if (!snakeGame.move()) { // Game over
+
+		ScopedTimer moveTimer(&profiler, MOVE_PHASE);
+		roundTicks += snakeGame.isPlaying();
+		Metrics::add(TICKS_COUNTER, snakeGame.isPlaying());
+		bool alive = snakeGame.move();
+		moveTimer.stop();
+		if (!alive) { // Game over
 			// Prepare game over screen
 			newHigh = initializeGameOver(gameOverDisplay, &dataDisplay[HIGH_SCORE],
-																	 snakeGame.getScore(), gameData);
+																	 snakeGame.getScore(), roundTicks, gameData,
+																	 &stats);
 			// Reset game
 			snakeGame.reset();
 			SDL_SetWindowResizable(window, SDL_TRUE);
 			gameOver = true; // Display game over screen
 		}
 
+		if (SDL_GetTicks64() - saveTicks >= AUTOSAVE_TICKS) {
+			autosave.save(snakeGame, gameData, TOTAL_DATA);
+			saveTicks = SDL_GetTicks64();
+		}
+
+		ScopedTimer renderTimer(&profiler, RENDER_PHASE);
 		SDL_SetRenderDrawColor(renderer, 0xff, 0xff, 0xff, 0xff);
 		SDL_RenderClear(renderer);
+		Metrics::add(DRAW_CALLS_COUNTER);
 
 		if (!snakeGame.isPlaying() && !gameOver) { // Initialization
 			renderInitialization(instructions, dataDisplay, renderer);
@@ -603,9 +847,25 @@ int main(int argc, char* argv[]) {
 			renderGameOver(gameOverDisplay, &dataDisplay[HIGH_SCORE], renderer,
 										 newHigh);
 		}
-		snakeGame.render();
+		snakeGame.render(&camera);
+		if (showProfile) {
+			if (SDL_GetTicks64() - profileLoadTicks >= PROFILE_REFRESH_TICKS) {
+				updateProfileText(profileDisplay, profiler);
+				profileLoadTicks = SDL_GetTicks64();
+			}
+			renderProfile(profileDisplay);
+		}
+		renderTimer.stop();
 
+		ScopedTimer presentTimer(&profiler, PRESENT_PHASE);
+		TraceScope presentTrace("present");
 		SDL_RenderPresent(renderer);
+		presentTrace.stop();
+		presentTimer.stop();
+		Metrics::add(FRAMES_COUNTER);
+		Metrics::set(FRAME_DRAW_CALLS_GAUGE,
+								 Metrics::getCount(DRAW_CALLS_COUNTER) - drawCalls);
+		Metrics::set(SCORE_GAUGE, snakeGame.isPlaying() ? snakeGame.getScore() : 0);
 		int finishTime = SDL_GetTicks64() - startTicks;
 		if (finishTime < 0) continue;
 
@@ -618,9 +878,26 @@ int main(int argc, char* argv[]) {
 			sleepTime = TICKS_FOR_60_FPS - finishTime;
 		}
 		if (sleepTime > 0) {
-			SDL_Delay(sleepTime);
+			profiler.delay(sleepTime);
 		}
+		dueTicks = startTicks + finishTime + std::max(sleepTime, 0);
+	}
+	Metrics::stopExport();
+	stats.close();
+	autosave.close();
+	if (!saveSnapshot(SNAPSHOT_PATH, snakeGame, gameData, TOTAL_DATA)) {
+		std::cout << "Unable to save " << SNAPSHOT_PATH << '\n';
+	}
+	if (trace && !Tracer::write(TRACE_PATH)) {
+		std::cout << "Unable to write " << TRACE_PATH << '\n';
+	}
+	if (profileToFile && !profiler.writeCSV(PROFILE_PATH)) {
+		std::cout << "Unable to write " << PROFILE_PATH << '\n';
+	}
+	for (int i = 0; i < TOTAL_PHASES; i++) {
+		profileDisplay[i].free();
 	}
+	delete rasterizer;
 	closeSDL(window, renderer, font, instructions, dataDisplay, gameOverDisplay);
 	snakeGame.reset();
 	window = NULL;
@@ -0,0 +1,280 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <poll.h>
+#include <SDL2/SDL.h>
+#include <sstream>
+#include <string>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+#include "Metrics.hh"
+#include "Profiler.hh"
+
+// Longest the export thread waits before noticing it should stop
+#define METRICS_POLL_MS (100)
+
+// Longest a client of the socket may take to send its request or read
+#define METRICS_CLIENT_TIMEOUT_MS (100)
+
+// Clients that send an HTTP request get an HTTP response, others just the text
+#define HTTP_REQUEST ("GET ")
+#define HTTP_HEADER ("HTTP/1.0 200 OK\r\n" \
+										 "Content-Type: text/plain; version=0.0.4\r\n\r\n")
+
+// Name and help text of a metric as exported
+struct MetricInfo {
+	const char* name;
+	const char* help;
+};
+
+static const MetricInfo COUNTER_INFO[TOTAL_COUNTERS] = {
+	{"snake_frames_total", "Frames drawn by the main loop."},
+	{"snake_ticks_total", "Times the snake moved."},
+	{"snake_late_ticks_total", "Ticks that started well after they were due."},
+	{"snake_dropped_inputs_total",
+	 "Turns rejected or replaced by another before the snake moved."},
+	{"snake_text_loads_total", "Lines of text rasterized with SDL_ttf."},
+	{"snake_draw_calls_total", "SDL draw calls made while rendering."}
+};
+
+static const MetricInfo GAUGE_INFO[TOTAL_GAUGES] = {
+	{"snake_frame_draw_calls", "SDL draw calls made by the last frame."},
+	{"snake_tick_drift_seconds",
+	 "How long after it was due the last frame started."},
+	{"snake_score", "Score of the round being played, 0 between rounds."}
+};
+
+// Factor from each gauge's stored value to the unit it is exported in
+static const double GAUGE_SCALE[TOTAL_GAUGES] = {1, 1e-3, 1};
+
+#define PHASE_METRIC ("snake_phase_seconds")
+#define PHASE_HELP ("Time spent in each phase of a frame of the main loop.")
+
+// Upper bounds in nanoseconds of every histogram bucket but the last
+static const Uint64 BUCKET_BOUNDS[METRIC_BUCKETS - 1] = {
+	50000, 100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000,
+	25000000, 50000000, 100000000, 250000000, 1000000000
+};
+
+std::atomic<bool> Metrics::_enabled(false);
+std::atomic<Uint64> Metrics::_counters[TOTAL_COUNTERS];
+std::atomic<Sint64> Metrics::_gauges[TOTAL_GAUGES];
+
+// Durations of each phase, bucketed and summed in nanoseconds
+static std::atomic<Uint64> phaseBuckets[TOTAL_PHASES][METRIC_BUCKETS];
+static std::atomic<Uint64> phaseSums[TOTAL_PHASES];
+
+// State of the export thread
+static std::thread exportThread;
+static std::atomic<bool> exportStopping(false);
+static std::string exportFile;
+static std::string exportSocket;
+static int listenFd = -1;
+static Uint32 exportIntervalMs = 0;
+
+// Start or stop counting, nothing is recorded while disabled
+void Metrics::setEnabled(bool enabled) {
+	_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+/**
+ * Add a duration to the histogram of a phase
+ * @param phase The Phase that was timed
+ * @param ns Duration in nanoseconds
+ */
+void Metrics::observe(int phase, Uint64 ns) {
+	if (!isEnabled()) {
+		return;
+	}
+	int bucket = 0;
+	while (bucket < METRIC_BUCKETS - 1 && ns > BUCKET_BOUNDS[bucket]) {
+		bucket++;
+	}
+	phaseBuckets[phase][bucket].fetch_add(1, std::memory_order_relaxed);
+	phaseSums[phase].fetch_add(ns, std::memory_order_relaxed);
+}
+
+/**
+ * Describe every metric in the Prometheus text exposition format
+ * @return The text
+ */
+std::string Metrics::format() {
+	std::stringstream text;
+	text.precision(9);
+	for (int i = 0; i < TOTAL_COUNTERS; i++) {
+		text << "# HELP " << COUNTER_INFO[i].name << ' ' << COUNTER_INFO[i].help
+				 << "\n# TYPE " << COUNTER_INFO[i].name << " counter\n"
+				 << COUNTER_INFO[i].name << ' ' << getCount((Counter) i) << '\n';
+	}
+	for (int i = 0; i < TOTAL_GAUGES; i++) {
+		text << "# HELP " << GAUGE_INFO[i].name << ' ' << GAUGE_INFO[i].help
+				 << "\n# TYPE " << GAUGE_INFO[i].name << " gauge\n"
+				 << GAUGE_INFO[i].name << ' '
+				 << getGauge((Gauge) i) * GAUGE_SCALE[i] << '\n';
+	}
+
+	text << "# HELP " << PHASE_METRIC << ' ' << PHASE_HELP << "\n# TYPE "
+			 << PHASE_METRIC << " histogram\n";
+	for (int p = 0; p < TOTAL_PHASES; p++) {
+		// Buckets are cumulative, and the count is their total so the two agree
+		// even while other threads keep observing
+		Uint64 count = 0;
+		for (int b = 0; b < METRIC_BUCKETS; b++) {
+			count += phaseBuckets[p][b].load(std::memory_order_relaxed);
+			text << PHASE_METRIC << "_bucket{phase=\"" << PHASE_NAMES[p]
+					 << "\",le=\"";
+			if (b < METRIC_BUCKETS - 1) {
+				text << BUCKET_BOUNDS[b] / 1e9;
+			} else {
+				text << "+Inf";
+			}
+			text << "\"} " << count << '\n';
+		}
+		text << PHASE_METRIC << "_sum{phase=\"" << PHASE_NAMES[p] << "\"} "
+				 << phaseSums[p].load(std::memory_order_relaxed) / 1e9 << '\n'
+				 << PHASE_METRIC << "_count{phase=\"" << PHASE_NAMES[p] << "\"} "
+				 << count << '\n';
+	}
+	return text.str();
+}
+
+/**
+ * Write every metric to a file, replacing it at once so readers never see a
+ * partly written file
+ * @param path Path of the file
+ * @return Whether it was written
+ */
+bool Metrics::writeFile(const std::string& path) {
+	std::string tempPath = path + ".tmp";
+	{
+		std::ofstream file(tempPath);
+		file << format();
+		if (!file.flush()) {
+			return false;
+		}
+	}
+	return rename(tempPath.c_str(), path.c_str()) == 0;
+}
+
+// Send the metrics to the next client waiting on the socket
+static void serveClient() {
+	int fd = accept4(listenFd, NULL, NULL, SOCK_CLOEXEC);
+	if (fd < 0) {
+		return;
+	}
+	struct timeval timeout = {0, METRICS_CLIENT_TIMEOUT_MS * 1000};
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof timeout);
+	setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof timeout);
+	char request[1024];
+	ssize_t received = recv(fd, request, sizeof request, 0);
+	std::string response = Metrics::format();
+	if (received >= (ssize_t) strlen(HTTP_REQUEST) &&
+			memcmp(request, HTTP_REQUEST, strlen(HTTP_REQUEST)) == 0) {
+		response = HTTP_HEADER + response;
+	}
+	size_t sent = 0;
+	while (sent < response.size()) {
+		ssize_t n = send(fd, response.data() + sent, response.size() - sent,
+										 MSG_NOSIGNAL);
+		if (n <= 0) {
+			break;
+		}
+		sent += n;
+	}
+	close(fd);
+}
+
+// Loop run by the export thread, writing the file when it is due and serving
+// clients in between
+static void exportLoop() {
+	Uint64 nextWrite = SDL_GetTicks64();
+	while (!exportStopping.load()) {
+		Uint64 now = SDL_GetTicks64();
+		int timeout = METRICS_POLL_MS;
+		if (!exportFile.empty()) {
+			if (now >= nextWrite) {
+				Metrics::writeFile(exportFile);
+				nextWrite = now + exportIntervalMs;
+			}
+			timeout = std::min((Uint64) timeout, nextWrite - now);
+		}
+		struct pollfd listener = {listenFd, POLLIN, 0};
+		if (poll(&listener, listenFd >= 0 ? 1 : 0, timeout) > 0) {
+			serveClient();
+		}
+	}
+}
+
+/**
+ * Start a thread that keeps the metrics available outside the program
+ * Metrics should be enabled as well, or every value stays at 0
+ * @param file Path of a file the metrics are written to, empty for none
+ * @param socket Path of a Unix socket every client of which is sent the
+ 								 metrics, anything already there is replaced. Empty for none.
+ * @param intervalMs Milliseconds between writes of the file
+ * @return Whether the socket could be opened
+ */
+bool Metrics::startExport(const std::string& file, const std::string& socket,
+													Uint32 intervalMs) {
+	stopExport();
+	if (!socket.empty()) {
+		struct sockaddr_un address;
+		if (socket.size() >= sizeof address.sun_path) {
+			return false;
+		}
+		memset(&address, 0, sizeof address);
+		address.sun_family = AF_UNIX;
+		memcpy(address.sun_path, socket.c_str(), socket.size());
+		unlink(socket.c_str());
+		listenFd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+		if (listenFd < 0 ||
+				bind(listenFd, (struct sockaddr*) &address, sizeof address) != 0 ||
+				listen(listenFd, SOMAXCONN) != 0) {
+			if (listenFd >= 0) {
+				close(listenFd);
+			}
+			listenFd = -1;
+			return false;
+		}
+	}
+	exportFile = file;
+	exportSocket = socket;
+	exportIntervalMs = intervalMs;
+	exportStopping = false;
+	exportThread = std::thread(exportLoop);
+	return true;
+}
+
+// Stop the export thread, writing the file one last time and removing the
+// socket
+void Metrics::stopExport() {
+	if (!exportThread.joinable()) {
+		return;
+	}
+	exportStopping = true;
+	exportThread.join();
+	if (!exportFile.empty()) {
+		writeFile(exportFile);
+	}
+	if (listenFd >= 0) {
+		close(listenFd);
+		unlink(exportSocket.c_str());
+		listenFd = -1;
+	}
+}
+
+// Getters
+
+Uint64 Metrics::getCount(Counter counter) {
+	return _counters[counter].load(std::memory_order_relaxed);
+}
+
+Sint64 Metrics::getGauge(Gauge gauge) {
+	return _gauges[gauge].load(std::memory_order_relaxed);
+}
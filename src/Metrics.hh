@@ -0,0 +1,71 @@
+#ifndef METRICS_HH
+#define METRICS_HH
+
+#include <atomic>
+#include <SDL2/SDL.h>
+#include <string>
+
+// Events counted since the program started
+enum Counter {
+	FRAMES_COUNTER,
+	TICKS_COUNTER,
+	LATE_TICKS_COUNTER,     // Ticks that started well after they were due
+	DROPPED_INPUTS_COUNTER, // Turns rejected or replaced before the snake moved
+	TEXT_LOADS_COUNTER,     // Lines of text rasterized by loadText
+	DRAW_CALLS_COUNTER,
+	TOTAL_COUNTERS
+};
+
+// Values that go up and down
+enum Gauge {
+	FRAME_DRAW_CALLS_GAUGE, // Draw calls of the last frame
+	TICK_DRIFT_GAUGE,       // Milliseconds the last frame started after it was due
+	SCORE_GAUGE,            // Score of the round being played
+	TOTAL_GAUGES
+};
+
+// Buckets of each phase's latency histogram, the last holds everything slower
+// than the largest bound
+#define METRIC_BUCKETS (14)
+
+/**
+ * Counters, gauges and per-phase latency histograms that any thread can
+ * update without locks, written out in the Prometheus text format
+ * Updating only checks a flag while metrics are disabled. Once enabled, an
+ * export thread can write them to a file every few seconds and serve them to
+ * anyone connecting to a Unix socket, so unattended machines can be watched
+ * without a profiler.
+ */
+class Metrics {
+	public:
+		static void setEnabled(bool);
+		static inline bool isEnabled() {
+			return _enabled.load(std::memory_order_relaxed);
+		}
+		static inline void add(Counter counter, Uint64 n = 1) {
+			if (isEnabled()) {
+				_counters[counter].fetch_add(n, std::memory_order_relaxed);
+			}
+		}
+		static inline void set(Gauge gauge, Sint64 value) {
+			if (isEnabled()) {
+				_gauges[gauge].store(value, std::memory_order_relaxed);
+			}
+		}
+		static void observe(int, Uint64);
+		static std::string format();
+		static bool writeFile(const std::string&);
+		static bool startExport(const std::string&, const std::string&, Uint32);
+		static void stopExport();
+
+		// Getters
+		static Uint64 getCount(Counter);
+		static Sint64 getGauge(Gauge);
+
+	private:
+		static std::atomic<bool> _enabled;
+		static std::atomic<Uint64> _counters[TOTAL_COUNTERS];
+		static std::atomic<Sint64> _gauges[TOTAL_GAUGES];
+};
+
+#endif
@@ -0,0 +1,172 @@
+#include <fstream>
+#include <SDL2/SDL.h>
+#include <sstream>
+#include <string>
+
+#include "Metrics.hh"
+#include "Profiler.hh"
+
+#define NS_PER_US (1000)
+
+// Bits of each value kept exactly by its bucket, including the leading one
+#define SUB_BUCKET_BITS (4)
+#define SUB_BUCKETS (1 << SUB_BUCKET_BITS)
+#define HALF_SUB_BUCKETS (SUB_BUCKETS / 2)
+
+// Start out disabled with empty histograms
+Profiler::Profiler() {
+	_enabled = false;
+	_nsPerTick = 1e9 / SDL_GetPerformanceFrequency();
+	clear();
+}
+
+// Turn timing on or off, ScopedTimers do nothing while it is off
+void Profiler::setEnabled(bool enabled) {
+	_enabled = enabled;
+}
+
+bool Profiler::isEnabled() const {
+	return _enabled;
+}
+
+// Empty every histogram
+void Profiler::clear() {
+	for (int p = 0; p < TOTAL_PHASES; p++) {
+		for (int b = 0; b < HISTOGRAM_BUCKETS; b++) {
+			_buckets[p][b] = 0;
+		}
+		_counts[p] = 0;
+		_totals[p] = 0;
+		_max[p] = 0;
+	}
+}
+
+/**
+ * Add a duration to the histogram of a phase, and to the metrics' one
+ * @param phase The phase that was timed
+ * @param ticks Duration in performance counter ticks
+ */
+void Profiler::record(Phase phase, Uint64 ticks) {
+	Uint64 ns = ticks * _nsPerTick;
+	Metrics::observe(phase, ns);
+	if (!_enabled) {
+		return;
+	}
+	_buckets[phase][bucketIndex(ns)]++;
+	_counts[phase]++;
+	_totals[phase] += ns;
+	if (ns > _max[phase]) {
+		_max[phase] = ns;
+	}
+}
+
+/**
+ * Sleep with SDL_Delay, timing the sleep and how far it overshot when the
+ * profiler or the metrics are enabled
+ * @param ms Milliseconds to sleep for
+ */
+void Profiler::delay(Uint32 ms) {
+	if (!_enabled && !Metrics::isEnabled()) {
+		SDL_Delay(ms);
+		return;
+	}
+	Uint64 start = SDL_GetPerformanceCounter();
+	SDL_Delay(ms);
+	Uint64 slept = SDL_GetPerformanceCounter() - start;
+	Uint64 requested = (Uint64) ms * SDL_GetPerformanceFrequency() / 1000;
+	record(SLEEP_PHASE, slept);
+	record(OVERSLEEP_PHASE, slept > requested ? slept - requested : 0);
+}
+
+Uint64 Profiler::getCount(Phase phase) const {
+	return _counts[phase];
+}
+
+/**
+ * Estimate a percentile of the durations of a phase
+ * @param phase The phase
+ * @param percentile Between 0 and 100
+ * @return Upper limit in nanoseconds of the bucket holding the percentile,
+ 					 which is at most 1/8 above the true value, and never above the max
+ */
+Uint64 Profiler::getPercentile(Phase phase, double percentile) const {
+	if (_counts[phase] == 0) {
+		return 0;
+	}
+	Uint64 rank = (Uint64) (percentile / 100 * _counts[phase]);
+	if (rank >= _counts[phase]) {
+		rank = _counts[phase] - 1;
+	}
+	Uint64 seen = 0;
+	for (int b = 0; b < HISTOGRAM_BUCKETS; b++) {
+		seen += _buckets[phase][b];
+		if (seen > rank) {
+			Uint64 limit = bucketLimit(b);
+			return limit < _max[phase] ? limit : _max[phase];
+		}
+	}
+	return _max[phase];
+}
+
+Uint64 Profiler::getMax(Phase phase) const {
+	return _max[phase];
+}
+
+Uint64 Profiler::getMean(Phase phase) const {
+	return _counts[phase] == 0 ? 0 : _totals[phase] / _counts[phase];
+}
+
+/**
+ * One line summary of a phase for the overlay
+ * @param phase The phase
+ * @return The phase's name with its p50, p99 and max in microseconds
+ */
+std::string Profiler::describe(Phase phase) const {
+	std::stringstream text;
+	text << PHASE_NAMES[phase] << ": p50 " << getPercentile(phase, 50) / NS_PER_US
+			 << " us, p99 " << getPercentile(phase, 99) / NS_PER_US << " us, max "
+			 << getMax(phase) / NS_PER_US << " us";
+	return text.str();
+}
+
+/**
+ * Write a summary of every phase to a CSV file
+ * @param path Path of the file, which is overwritten
+ * @return Whether the file was written
+ */
+bool Profiler::writeCSV(const std::string& path) const {
+	std::ofstream file(path);
+	if (!file) {
+		return false;
+	}
+	file << "phase,count,mean_us,p50_us,p99_us,max_us\n";
+	for (int p = 0; p < TOTAL_PHASES; p++) {
+		Phase phase = (Phase) p;
+		file << PHASE_NAMES[p] << ',' << getCount(phase) << ','
+				 << (double) getMean(phase) / NS_PER_US << ','
+				 << (double) getPercentile(phase, 50) / NS_PER_US << ','
+				 << (double) getPercentile(phase, 99) / NS_PER_US << ','
+				 << (double) getMax(phase) / NS_PER_US << '\n';
+	}
+	return (bool) file;
+}
+
+// Bucket a duration in nanoseconds falls in
+int Profiler::bucketIndex(Uint64 ns) {
+	if (ns < SUB_BUCKETS) {
+		return ns;
+	}
+	int msb = 63 - __builtin_clzll(ns);
+	int shift = msb - (SUB_BUCKET_BITS - 1);
+	return shift * HALF_SUB_BUCKETS + (ns >> shift);
+}
+
+// Largest duration in nanoseconds that falls in a bucket
+Uint64 Profiler::bucketLimit(int bucket) {
+	if (bucket < SUB_BUCKETS) {
+		return bucket;
+	}
+	int shift = bucket / HALF_SUB_BUCKETS - 1;
+	Uint64 mantissa = bucket % HALF_SUB_BUCKETS + HALF_SUB_BUCKETS;
+	return ((mantissa + 1) << shift) - 1;
+}
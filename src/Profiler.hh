@@ -0,0 +1,95 @@
+#ifndef PROFILER_HH
+#define PROFILER_HH
+
+#include <SDL2/SDL.h>
+#include <string>
+
+#include "Metrics.hh"
+
+// Parts of each frame of the main loop that are timed
+enum Phase {
+	EVENTS_PHASE,
+	MOVE_PHASE,
+	RENDER_PHASE,
+	PRESENT_PHASE,
+	SLEEP_PHASE,
+	OVERSLEEP_PHASE, // Time SDL_Delay slept past what was asked for
+	TOTAL_PHASES
+};
+
+// Name of each phase in the overlay, the CSV and the exported metrics
+const std::string PHASE_NAMES[] = {"events", "move", "render", "present",
+																	 "sleep", "oversleep"};
+
+// Buckets per histogram, enough for any 64-bit number of nanoseconds
+#define HISTOGRAM_BUCKETS (512)
+
+class Profiler {
+	public:
+		Profiler();
+		void setEnabled(bool);
+		bool isEnabled() const;
+		void clear();
+		void record(Phase, Uint64);
+		void delay(Uint32);
+		Uint64 getCount(Phase) const;
+		Uint64 getPercentile(Phase, double) const;
+		Uint64 getMax(Phase) const;
+		Uint64 getMean(Phase) const;
+		std::string describe(Phase) const;
+		bool writeCSV(const std::string&) const;
+
+	private:
+		bool _enabled;
+
+		// Log-linear histogram of durations in nanoseconds for each phase:
+		// values below 16 get their own bucket, larger values share a bucket
+		// with values that agree in their 4 highest bits
+		Uint64 _buckets[TOTAL_PHASES][HISTOGRAM_BUCKETS];
+		Uint64 _counts[TOTAL_PHASES];
+		Uint64 _totals[TOTAL_PHASES];
+		Uint64 _max[TOTAL_PHASES];
+
+		// Factor from performance counter ticks to nanoseconds
+		double _nsPerTick;
+
+		static int bucketIndex(Uint64);
+		static Uint64 bucketLimit(int);
+};
+
+/**
+ * Time the enclosing scope and add it to a phase of a profiler, and to the
+ * phase's histogram in the metrics
+ * When both are disabled this only checks two flags, no clock is read
+ */
+class ScopedTimer {
+	public:
+		ScopedTimer(Profiler* profiler, Phase phase) {
+			_profiler = profiler->isEnabled() || Metrics::isEnabled() ? profiler :
+									NULL;
+			_phase = phase;
+			_start = _profiler != NULL ? SDL_GetPerformanceCounter() : 0;
+		}
+
+		~ScopedTimer() {
+			stop();
+		}
+
+		// Record the time so far, for phases that end before the scope does
+		void stop() {
+			if (_profiler != NULL) {
+				_profiler->record(_phase, SDL_GetPerformanceCounter() - _start);
+				_profiler = NULL;
+			}
+		}
+
+		ScopedTimer(const ScopedTimer&) = delete;
+		ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+	private:
+		Profiler* _profiler;
+		Phase _phase;
+		Uint64 _start;
+};
+
+#endif
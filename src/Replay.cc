@@ -0,0 +1,182 @@
+#include <functional>
+#include <SDL2/SDL.h>
+#include <utility>
+#include <vector>
+
+#include "Replay.hh"
+#include "SnakeGame.hh"
+
+// Append a number in as few bytes as it needs, 7 bits at a time
+static void putVarint(std::vector<Uint8>* out, Uint64 value) {
+	while (value >= 0x80) {
+		out->push_back((value & 0x7f) | 0x80);
+		value >>= 7;
+	}
+	out->push_back(value);
+}
+
+/**
+ * Read a number written by putVarint
+ * @param data Position to read from, moved past the number
+ * @param end End of the data
+ * @param value Set to the number read
+ * @return Whether a whole number was read
+ */
+static bool getVarint(const Uint8** data, const Uint8* end, Uint64* value) {
+	*value = 0;
+	for (int shift = 0; shift < 64 && *data < end; shift += 7) {
+		Uint8 byte = *(*data)++;
+		*value |= (Uint64) (byte & 0x7f) << shift;
+		if (byte < 0x80) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// An empty replay
+Replay::Replay() {
+	start({0, 0, 0, 0, 0, 0}, 0);
+}
+
+/**
+ * Start recording a round
+ * @param settings Settings the round is played with
+ * @param seed Seed the game was initialized with
+ */
+void Replay::start(const RoundSettings& settings, Uint64 seed) {
+	_settings = settings;
+	_settings.padding = 0;
+	_seed = seed;
+	_score = 0;
+	_ticks = 0;
+	_inputs.clear();
+}
+
+/**
+ * Record one tick of the round, called just before the snake moves
+ * @param direction Direction the snake is about to move in
+ */
+void Replay::recordTick(Direction direction) {
+	Direction current = _inputs.empty() ? NONE : _inputs.back().second;
+	if (direction != current) {
+		_inputs.push_back(std::pair(_ticks, direction));
+	}
+	_ticks++;
+}
+
+/**
+ * Finish recording a round
+ * @param score Score the round ended with
+ */
+void Replay::finish(Uint64 score) {
+	_score = score;
+}
+
+/**
+ * Play the round again from its seed and inputs
+ * @param game Game that is initialized and played, left where the round ended
+ * @param onTick Called with the game once it is initialized and after every
+ 								 move, if given
+ * @return Whether the round ended with the recorded score
+ */
+bool Replay::play(SnakeGame* game,
+									const std::function<void(const SnakeGame&)>& onTick) const {
+	game->init(_settings.rows, _settings.cols, _settings.apples, _seed);
+	if (onTick) {
+		onTick(*game);
+	}
+	size_t next = 0;
+	for (Uint64 tick = 0; tick < _ticks; tick++) {
+		if (next < _inputs.size() && _inputs[next].first == tick) {
+			game->setDirection(_inputs[next].second);
+			next++;
+		}
+		bool playing = game->move();
+		if (onTick) {
+			onTick(*game);
+		}
+		if (!playing) {
+			break;
+		}
+	}
+	return game->getScore() == _score;
+}
+
+/**
+ * Write the replay compactly, each change of direction takes one or two bytes
+ * @param out Vector the encoded replay is added to
+ */
+void Replay::encode(std::vector<Uint8>* out) const {
+	putVarint(out, _settings.rows);
+	putVarint(out, _settings.cols);
+	putVarint(out, _settings.apples);
+	putVarint(out, _settings.timeDelay);
+	putVarint(out, _settings.acceleration);
+	putVarint(out, _seed);
+	putVarint(out, _score);
+	putVarint(out, _ticks);
+	putVarint(out, _inputs.size());
+	Uint64 lastTick = 0;
+	for (const std::pair<Uint64, Direction>& input : _inputs) {
+		putVarint(out, (input.first - lastTick) << 2 | input.second);
+		lastTick = input.first;
+	}
+}
+
+/**
+ * Read a replay written by encode
+ * @param data The encoded replay
+ * @param size Size of the encoded replay in bytes
+ * @return Whether the whole replay could be read
+ */
+bool Replay::decode(const Uint8* data, size_t size) {
+	const Uint8* end = data + size;
+	Uint64 fields[9];
+	for (int i = 0; i < 9; i++) {
+		if (!getVarint(&data, end, &fields[i])) {
+			return false;
+		}
+	}
+	start({(Uint32) fields[0], (Uint32) fields[1], (Uint32) fields[2], 0,
+				 fields[3], fields[4]}, fields[5]);
+	_score = fields[6];
+	_ticks = fields[7];
+	Uint64 nInputs = fields[8];
+	if (nInputs > size) { // Every input takes at least a byte
+		return false;
+	}
+	_inputs.reserve(nInputs);
+	Uint64 tick = 0;
+	for (Uint64 i = 0; i < nInputs; i++) {
+		Uint64 value;
+		if (!getVarint(&data, end, &value)) {
+			return false;
+		}
+		tick += value >> 2;
+		_inputs.push_back(std::pair(tick, (Direction) (value & 3)));
+	}
+	return data == end;
+}
+
+// Getters
+
+const RoundSettings& Replay::getSettings() const {
+	return _settings;
+}
+
+Uint64 Replay::getSeed() const {
+	return _seed;
+}
+
+Uint64 Replay::getScore() const {
+	return _score;
+}
+
+Uint64 Replay::getTicks() const {
+	return _ticks;
+}
+
+size_t Replay::getInputCount() const {
+	return _inputs.size();
+}
@@ -0,0 +1,44 @@
+#ifndef REPLAY_HH
+#define REPLAY_HH
+
+#include <functional>
+#include <SDL2/SDL.h>
+#include <utility>
+#include <vector>
+
+#include "GameTypes.hh"
+#include "SnakeGame.hh"
+
+/**
+ * Everything needed to play a round again: its settings, the seed apples were
+ * placed with and the tick at which each change of direction happened
+ */
+class Replay {
+	public:
+		Replay();
+		void start(const RoundSettings&, Uint64);
+		void recordTick(Direction);
+		void finish(Uint64);
+		bool play(SnakeGame*,
+							const std::function<void(const SnakeGame&)>& = {}) const;
+		void encode(std::vector<Uint8>*) const;
+		bool decode(const Uint8*, size_t);
+
+		// Getters
+		const RoundSettings& getSettings() const;
+		Uint64 getSeed() const;
+		Uint64 getScore() const;
+		Uint64 getTicks() const;
+		size_t getInputCount() const;
+
+	private:
+		RoundSettings _settings;
+		Uint64 _seed;
+		Uint64 _score;
+		Uint64 _ticks;
+
+		// Tick at which the snake started moving in each new direction
+		std::vector<std::pair<Uint64, Direction>> _inputs;
+};
+
+#endif
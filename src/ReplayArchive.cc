@@ -0,0 +1,231 @@
+#include <algorithm>
+#include <fcntl.h>
+#include <fstream>
+#include <SDL2/SDL.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include "Checksum.hh"
+#include "ReplayArchive.hh"
+
+// Whether two rounds were played with the same settings
+static bool sameSettings(const RoundSettings& a, const RoundSettings& b) {
+	return a.rows == b.rows && a.cols == b.cols && a.apples == b.apples &&
+				 a.timeDelay == b.timeDelay && a.acceleration == b.acceleration;
+}
+
+/**
+ * Order of the index: by settings, then from the best score to the worst
+ * @return Whether a comes before b
+ */
+static bool entryBefore(const ArchiveEntry& a, const ArchiveEntry& b) {
+	if (a.settings.rows != b.settings.rows) {
+		return a.settings.rows < b.settings.rows;
+	}
+	if (a.settings.cols != b.settings.cols) {
+		return a.settings.cols < b.settings.cols;
+	}
+	if (a.settings.apples != b.settings.apples) {
+		return a.settings.apples < b.settings.apples;
+	}
+	if (a.settings.timeDelay != b.settings.timeDelay) {
+		return a.settings.timeDelay < b.settings.timeDelay;
+	}
+	if (a.settings.acceleration != b.settings.acceleration) {
+		return a.settings.acceleration < b.settings.acceleration;
+	}
+	return a.score > b.score;
+}
+
+/**
+ * Start a new archive, replacing any file at the path
+ * @param path Path of the archive
+ * @return Whether the file could be created
+ */
+bool ReplayArchiveWriter::open(const std::string& path) {
+	_file.open(path, std::ios::binary | std::ios::trunc);
+	ArchiveHeader header = {};
+	_file.write((const char*) &header, sizeof header);
+	_offset = sizeof header;
+	_entries.clear();
+	return (bool) _file;
+}
+
+/**
+ * Add a replay to the end of the archive
+ * @param replay A finished replay
+ */
+void ReplayArchiveWriter::add(const Replay& replay) {
+	_buffer.clear();
+	replay.encode(&_buffer);
+	_file.write((const char*) _buffer.data(), _buffer.size());
+	_entries.push_back({replay.getSettings(), replay.getScore(), _offset,
+											_buffer.size()});
+	_offset += _buffer.size();
+}
+
+/**
+ * Sort and write the index, then the header that points to it
+ * @return Whether the whole archive was written
+ */
+bool ReplayArchiveWriter::finish() {
+	std::stable_sort(_entries.begin(), _entries.end(), entryBefore);
+
+	// The index is aligned so it can be used straight from the memory map
+	static const char padding[sizeof(Uint64)] = {};
+	size_t pad = (sizeof(Uint64) - _offset % sizeof(Uint64)) % sizeof(Uint64);
+	_file.write(padding, pad);
+
+	ArchiveHeader header = {ARCHIVE_MAGIC, ARCHIVE_VERSION, _entries.size(),
+													_offset + pad,
+													checksum(_entries.data(),
+																	 _entries.size() * sizeof(ArchiveEntry))};
+	_file.write((const char*) _entries.data(),
+							_entries.size() * sizeof(ArchiveEntry));
+	_file.seekp(0);
+	_file.write((const char*) &header, sizeof header);
+	_file.close();
+	_entries.clear();
+	return !_file.fail();
+}
+
+// No archive is open until open is called
+ReplayArchive::ReplayArchive() {
+	_map = NULL;
+	_size = 0;
+	_index = NULL;
+	_nReplays = 0;
+}
+
+ReplayArchive::~ReplayArchive() {
+	close();
+}
+
+/**
+ * Map an archive and check its index
+ * @param path Path of the archive
+ * @return Whether the archive is intact and could be opened
+ */
+bool ReplayArchive::open(const std::string& path) {
+	close();
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	struct stat info;
+	if (fstat(fd, &info) != 0 || (size_t) info.st_size < sizeof(ArchiveHeader)) {
+		::close(fd);
+		return false;
+	}
+	void* map = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (map == MAP_FAILED) {
+		return false;
+	}
+	_map = (const Uint8*) map;
+	_size = info.st_size;
+
+	ArchiveHeader header;
+	memcpy(&header, _map, sizeof header);
+	if (header.magic != ARCHIVE_MAGIC || header.version != ARCHIVE_VERSION ||
+			header.indexOffset % sizeof(Uint64) != 0 ||
+			header.indexOffset > _size ||
+			header.nReplays != (_size - header.indexOffset) / sizeof(ArchiveEntry) ||
+			header.indexChecksum != checksum(_map + header.indexOffset,
+																			 _size - header.indexOffset)) {
+		close();
+		return false;
+	}
+	_index = (const ArchiveEntry*) (_map + header.indexOffset);
+	_nReplays = header.nReplays;
+	return true;
+}
+
+// Unmap the archive, entries found in it can no longer be used
+void ReplayArchive::close() {
+	if (_map != NULL) {
+		munmap((void*) _map, _size);
+	}
+	_map = NULL;
+	_size = 0;
+	_index = NULL;
+	_nReplays = 0;
+}
+
+/**
+ * Find the best scoring replays played with some settings
+ * @param settings The settings
+ * @param n Most replays to find
+ * @param entries Vector the entries found are added to, best first
+ * @return Number of entries found
+ */
+size_t ReplayArchive::topScores(const RoundSettings& settings, size_t n,
+																std::vector<const ArchiveEntry*>* entries) const {
+	const ArchiveEntry* end = _index + _nReplays;
+	size_t found = 0;
+	for (const ArchiveEntry* entry = findFirst(settings, ~0ULL);
+			 entry != end && found < n && sameSettings(entry->settings, settings);
+			 entry++) {
+		entries->push_back(entry);
+		found++;
+	}
+	return found;
+}
+
+/**
+ * Find the replays played with some settings that scored within a range
+ * @param settings The settings
+ * @param minScore Lowest score to find
+ * @param maxScore Highest score to find
+ * @param entries Vector the entries found are added to, best first
+ * @return Number of entries found
+ */
+size_t ReplayArchive::scoreRange(const RoundSettings& settings, Uint64 minScore,
+																 Uint64 maxScore,
+																 std::vector<const ArchiveEntry*>* entries) const {
+	const ArchiveEntry* end = _index + _nReplays;
+	size_t found = 0;
+	for (const ArchiveEntry* entry = findFirst(settings, maxScore);
+			 entry != end && entry->score >= minScore &&
+			 sameSettings(entry->settings, settings); entry++) {
+		entries->push_back(entry);
+		found++;
+	}
+	return found;
+}
+
+/**
+ * Binary search the index for the first replay with some settings that
+ * scored at most a given score
+ * @param settings The settings
+ * @param maxScore Highest score
+ * @return The first such entry, or where it would be
+ */
+const ArchiveEntry* ReplayArchive::findFirst(const RoundSettings& settings,
+																						 Uint64 maxScore) const {
+	ArchiveEntry probe = {settings, maxScore, 0, 0};
+	return std::lower_bound(_index, _index + _nReplays, probe, entryBefore);
+}
+
+/**
+ * Decode a replay found in the index
+ * @param entry Entry returned by a query on this archive
+ * @param replay Replay that is overwritten
+ * @return Whether the replay could be decoded
+ */
+bool ReplayArchive::load(const ArchiveEntry& entry, Replay* replay) const {
+	if (entry.offset < sizeof(ArchiveHeader) ||
+			entry.offset + entry.size > (Uint64) ((const Uint8*) _index - _map)) {
+		return false;
+	}
+	return replay->decode(_map + entry.offset, entry.size);
+}
+
+// Getters
+
+Uint64 ReplayArchive::getCount() const {
+	return _nReplays;
+}
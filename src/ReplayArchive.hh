@@ -0,0 +1,81 @@
+#ifndef REPLAY_ARCHIVE_HH
+#define REPLAY_ARCHIVE_HH
+
+#include <fstream>
+#include <SDL2/SDL.h>
+#include <string>
+#include <vector>
+
+#include "GameTypes.hh"
+#include "Replay.hh"
+
+#define ARCHIVE_MAGIC (0x50455253) // "SREP"
+#define ARCHIVE_VERSION (1)
+
+// Start of an archive file, followed by the encoded replays and the index
+struct ArchiveHeader {
+	Uint32 magic;
+	Uint32 version;
+	Uint64 nReplays;
+	Uint64 indexOffset;
+	Uint64 indexChecksum;
+};
+
+// Where one replay is stored and what it can be found by
+struct ArchiveEntry {
+	RoundSettings settings;
+	Uint64 score;
+	Uint64 offset;
+	Uint64 size;
+};
+
+/**
+ * Packs replays into one archive file, the index is sorted and written after
+ * the last replay once every replay has been added
+ */
+class ReplayArchiveWriter {
+	public:
+		bool open(const std::string&);
+		void add(const Replay&);
+		bool finish();
+
+	private:
+		std::ofstream _file;
+		Uint64 _offset;
+		std::vector<ArchiveEntry> _entries;
+		std::vector<Uint8> _buffer;
+};
+
+/**
+ * Answers queries about the replays in an archive from its memory-mapped
+ * index alone. The index is sorted by settings and then by score from best
+ * to worst, so a query is a binary search followed by a scan of the results.
+ * Replays are only decoded when asked for.
+ */
+class ReplayArchive {
+	public:
+		ReplayArchive();
+		~ReplayArchive();
+		ReplayArchive(const ReplayArchive&) = delete;
+		ReplayArchive& operator=(const ReplayArchive&) = delete;
+		bool open(const std::string&);
+		void close();
+		size_t topScores(const RoundSettings&, size_t,
+										 std::vector<const ArchiveEntry*>*) const;
+		size_t scoreRange(const RoundSettings&, Uint64, Uint64,
+											std::vector<const ArchiveEntry*>*) const;
+		bool load(const ArchiveEntry&, Replay*) const;
+
+		// Getters
+		Uint64 getCount() const;
+
+	private:
+		const Uint8* _map;
+		size_t _size;
+		const ArchiveEntry* _index;
+		Uint64 _nReplays;
+
+		const ArchiveEntry* findFirst(const RoundSettings&, Uint64) const;
+};
+
+#endif
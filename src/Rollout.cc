@@ -0,0 +1,215 @@
+#include <SDL2/SDL.h>
+#include <vector>
+
+#include "Rollout.hh"
+#include "SnakeGame.hh"
+#include "WorkerPool.hh"
+
+// Value of a playout that ends in a collision on its first move
+#define DEATH_VALUE (-1.0)
+
+// Mix the bits of a value (splitmix64 finalizer), used to derive seeds
+static Uint64 mix(Uint64 z) {
+	z += 0x9e3779b97f4a7c15ULL;
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+// Cell reached by moving one step from loc in the given direction
+static std::pair<int, int> step(std::pair<int, int> loc, Direction direction) {
+	switch (direction) {
+		case UP:
+			loc.first--;
+			break;
+		case DOWN:
+			loc.first++;
+			break;
+		case LEFT:
+			loc.second--;
+			break;
+		case RIGHT:
+			loc.second++;
+			break;
+		case NONE:
+			break;
+	}
+	return loc;
+}
+
+/**
+ * Create an evaluator that scores candidate moves with random playouts
+ * @param nThreads Number of worker threads used for each evaluation
+ * @param rolloutsPerMove Number of playouts run for each candidate move
+ * @param maxDepth Maximum number of moves in a single playout
+ * @param policy How moves are chosen during a playout
+ */
+RolloutEvaluator::RolloutEvaluator(int nThreads, int rolloutsPerMove,
+																	 int maxDepth, RolloutPolicy policy)
+		: _pool(nThreads > 0 ? nThreads : 1) {
+	_nThreads = _pool.getThreadCount();
+	_rolloutsPerMove = rolloutsPerMove;
+	_maxDepth = maxDepth;
+	_policy = policy;
+	_rolloutCount = 0;
+	_arena.resize(_nThreads);
+}
+
+/**
+ * Score each move the snake could make next and return the best one
+ * Every candidate gets the same number of playouts, which are spread over
+ * the worker threads. The result only depends on the seed, not on the
+ * number of threads.
+ * @param game The position being evaluated, it is not changed
+ * @param seed Seed for the playouts and apple placement
+ * @param values If not NULL, receives the mean value of each direction
+ 								 (indexed by Direction), DEATH_VALUE for illegal moves
+ * @return The direction with the best mean value, NONE if the game is over
+ */
+Direction RolloutEvaluator::evaluate(const SnakeGame& game, Uint64 seed,
+																		 double* values) {
+	Direction candidates[NONE];
+	int nCandidates = 0;
+
+	// Skip the reverse direction, which setDirection would refuse
+	SnakeGame& probe = _arena[0];
+	game.clone(probe);
+	for (int d = 0; d < NONE; d++) {
+		if (probe.setDirection((Direction) d)) {
+			candidates[nCandidates++] = (Direction) d;
+		}
+	}
+	if (nCandidates == 0) {
+		return NONE;
+	}
+
+	// Every playout writes its own slot, which are summed in a fixed order
+	// afterwards so the result does not depend on how work was split
+	_results.resize(nCandidates * _rolloutsPerMove);
+	_pool.run(_nThreads, [&](int share, int worker) {
+		runShare(share, worker, game, candidates, nCandidates, seed);
+	});
+	_rolloutCount += (Uint64) nCandidates * _rolloutsPerMove;
+
+	Direction best = NONE;
+	double bestValue = 0;
+	for (int d = 0; d < NONE; d++) {
+		if (values != NULL) {
+			values[d] = DEATH_VALUE;
+		}
+	}
+	for (int i = 0; i < nCandidates; i++) {
+		double total = 0;
+		for (int k = 0; k < _rolloutsPerMove; k++) {
+			total += _results[i * _rolloutsPerMove + k];
+		}
+		double mean = total / _rolloutsPerMove;
+		if (values != NULL) {
+			values[candidates[i]] = mean;
+		}
+		if (best == NONE || mean > bestValue) {
+			best = candidates[i];
+			bestValue = mean;
+		}
+	}
+	return best;
+}
+
+/**
+ * Run one share of the playouts
+ * Playout k of every candidate belongs to share k % nThreads, whichever
+ * worker runs it
+ * @param share Index of the share
+ * @param worker Index of the worker running it and its slot in the arena
+ * @param game The root position
+ * @param candidates Moves being evaluated
+ * @param nCandidates Number of moves being evaluated
+ * @param seed Seed of the whole evaluation
+ */
+void RolloutEvaluator::runShare(int share, int worker, const SnakeGame& game,
+																const Direction* candidates, int nCandidates,
+																Uint64 seed) {
+	SnakeGame& scratch = _arena[worker];
+	for (int i = 0; i < nCandidates; i++) {
+		for (int k = share; k < _rolloutsPerMove; k += _nThreads) {
+			Uint64 rolloutSeed = mix(seed ^ mix(candidates[i] * 0x100000000ULL + k));
+			game.clone(scratch);
+			scratch.seed(rolloutSeed);
+			scratch.setDirection(candidates[i]);
+			_results[i * _rolloutsPerMove + k] = playout(scratch, rolloutSeed);
+		}
+	}
+}
+
+/**
+ * Play the game forward with the evaluator's policy
+ * The first move has already been chosen by setting the direction
+ * @param game Scratch game that is played out
+ * @param seed Seed for the policy
+ * @return Apples eaten during the playout plus the fraction of moves
+ 					 survived, DEATH_VALUE if the first move loses
+ */
+double RolloutEvaluator::playout(SnakeGame& game, Uint64 seed) {
+	Uint64 startScore = game.getScore();
+	Uint64 rng = seed;
+	int depth = 0;
+	while (depth < _maxDepth) {
+		if (depth > 0) {
+			game.setDirection(choose(game, _policy, &rng));
+		}
+		if (!game.move()) {
+			break;
+		}
+		depth++;
+	}
+	if (depth == 0) {
+		return DEATH_VALUE;
+	}
+	return (double) (game.getScore() - startScore) + (double) depth / _maxDepth;
+}
+
+/**
+ * Pick a direction for the snake according to a playout policy
+ * @param game The current position
+ * @param policy How the direction is chosen
+ * @param rng State of the generator used for random choices
+ * @return The chosen direction, NONE if the game is over
+ */
+Direction RolloutEvaluator::choose(const SnakeGame& game, RolloutPolicy policy,
+																	 Uint64* rng) {
+	std::pair<int, int> head = game.getHead();
+	Direction options[NONE];
+	int nOptions = 0;
+	Direction current = game.getDirection();
+	for (int d = 0; d < NONE; d++) {
+		// Never reverse, setDirection would ignore it anyway
+		if (current != NONE && game.getScore() > 1 && d == (current + 2) % NONE) {
+			continue;
+		}
+		if (policy == HEURISTIC_POLICY) {
+			std::pair<int, int> next = step(head, (Direction) d);
+			if (next.first < 0 || next.second < 0 || next.first >= game.getRows() ||
+					next.second >= game.getCols()) {
+				continue;
+			}
+			Spaces space = game.getCell(next.first, next.second);
+			if (space == APPLE) {
+				return (Direction) d;
+			} else if (space != BLANK) {
+				continue;
+			}
+		}
+		options[nOptions++] = (Direction) d;
+	}
+	if (nOptions == 0) {
+		return current;
+	}
+	*rng = mix(*rng);
+	return options[*rng % nOptions];
+}
+
+// Getters
+
+Uint64 RolloutEvaluator::getRolloutCount() const {
+	return _rolloutCount;
+}
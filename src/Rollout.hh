@@ -0,0 +1,56 @@
+#ifndef ROLLOUT_HH
+#define ROLLOUT_HH
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+#include "SnakeGame.hh"
+#include "WorkerPool.hh"
+
+// How the snake picks its moves during a playout
+enum RolloutPolicy {
+	RANDOM_POLICY,    // Any direction that does not reverse into the body
+	HEURISTIC_POLICY  // Eat adjacent apples, otherwise avoid immediate deaths
+};
+
+class RolloutEvaluator {
+	public:
+		RolloutEvaluator(int, int, int, RolloutPolicy = HEURISTIC_POLICY);
+		Direction evaluate(const SnakeGame&, Uint64, double* = NULL);
+
+		// Getters
+		Uint64 getRolloutCount() const;
+
+		// Pick the next move of a playout with the given policy
+		static Direction choose(const SnakeGame&, RolloutPolicy, Uint64*);
+
+	private:
+		// Number of worker threads playouts are split across
+		int _nThreads;
+
+		// Threads that run the playouts, kept between evaluations
+		WorkerPool _pool;
+
+		// Number of playouts run for every candidate move
+		int _rolloutsPerMove;
+
+		// Maximum number of moves in a single playout
+		int _maxDepth;
+
+		RolloutPolicy _policy;
+
+		// Preallocated games that each worker clones the root position into,
+		// one per worker so that no playout needs to allocate
+		std::vector<SnakeGame> _arena;
+
+		// Value of every playout of the current evaluation
+		std::vector<double> _results;
+
+		// Total number of playouts run by this evaluator
+		Uint64 _rolloutCount;
+
+		void runShare(int, int, const SnakeGame&, const Direction*, int, Uint64);
+		double playout(SnakeGame&, Uint64);
+};
+
+#endif
@@ -0,0 +1,96 @@
+#include <SDL2/SDL.h>
+#include <vector>
+
+#include "Search.hh"
+#include "SnakeGame.hh"
+#include "TranspositionTable.hh"
+
+// Value of a position where the snake has just died
+#define DEATH_VALUE (-1.0f)
+
+// Weight of each move survived compared to an apple eaten
+#define SURVIVAL_WEIGHT (0.01f)
+
+/**
+ * Create an agent that picks moves with a depth-limited search
+ * Apples that appear during the search are placed by each game's own
+ * generator, so the search is deterministic for a given position.
+ * @param depth Number of moves to look ahead
+ * @param table Transposition table used to skip positions that were already
+ 								searched, NULL to search without one
+ */
+SearchAgent::SearchAgent(int depth, TranspositionTable* table) {
+	_depth = depth > 0 ? depth : 1;
+	_table = table;
+	_stack.resize(_depth + 1);
+	_nodeCount = 0;
+	_tableHits = 0;
+}
+
+/**
+ * Find the best move from the given position
+ * @param game The position being searched, it is not changed
+ * @return The direction with the best value, NONE if every move loses
+ */
+Direction SearchAgent::search(const SnakeGame& game) {
+	game.clone(_stack[0]);
+	Direction best = NONE;
+	searchNode(0, _depth, &best);
+	return best;
+}
+
+/**
+ * Search the position stored in the given ply of the stack
+ * @param ply Index of the position in the stack
+ * @param depth Number of moves left to search
+ * @param bestMove Receives the best move from this position
+ * @return Apples eaten plus a small bonus for every move survived
+ */
+float SearchAgent::searchNode(int ply, int depth, Direction* bestMove) {
+	_nodeCount++;
+	SnakeGame& node = _stack[ply];
+	Uint64 hash = node.getHash();
+	float value;
+	if (_table != NULL && _table->probe(hash, depth, &value, bestMove)) {
+		_tableHits++;
+		return value;
+	}
+
+	SnakeGame& child = _stack[ply + 1];
+	float bestValue = DEATH_VALUE;
+	*bestMove = NONE;
+	for (int d = 0; d < NONE; d++) {
+		node.clone(child);
+		if (!child.setDirection((Direction) d)) {
+			continue;
+		}
+		Uint64 score = child.getScore();
+		if (!child.move()) {
+			continue;
+		}
+		float childValue = (float) (child.getScore() - score) + SURVIVAL_WEIGHT;
+		if (depth > 1) {
+			Direction childMove;
+			childValue += searchNode(ply + 1, depth - 1, &childMove);
+		}
+		if (*bestMove == NONE || childValue > bestValue) {
+			bestValue = childValue;
+			*bestMove = (Direction) d;
+		}
+	}
+
+	if (_table != NULL) {
+		_table->store(hash, depth, bestValue, *bestMove);
+	}
+	return bestValue;
+}
+
+// Getters
+
+Uint64 SearchAgent::getNodeCount() const {
+	return _nodeCount;
+}
+
+Uint64 SearchAgent::getTableHits() const {
+	return _tableHits;
+}
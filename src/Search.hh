@@ -0,0 +1,36 @@
+#ifndef SEARCH_HH
+#define SEARCH_HH
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+#include "SnakeGame.hh"
+#include "TranspositionTable.hh"
+
+class SearchAgent {
+	public:
+		SearchAgent(int, TranspositionTable* = NULL);
+		Direction search(const SnakeGame&);
+
+		// Getters
+		Uint64 getNodeCount() const;
+		Uint64 getTableHits() const;
+
+	private:
+		// Number of moves looked ahead
+		int _depth;
+
+		// Table shared with other agents, NULL to search without one
+		TranspositionTable* _table;
+
+		// One preallocated game per ply so the search never allocates
+		std::vector<SnakeGame> _stack;
+
+		// Number of positions expanded and table lookups that saved a search
+		Uint64 _nodeCount;
+		Uint64 _tableHits;
+
+		float searchNode(int, int, Direction*);
+};
+
+#endif
@@ -0,0 +1,76 @@
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <SDL2/SDL.h>
+#include <string>
+#include <vector>
+
+#include "GameServer.hh"
+
+#define AUTOPLAY_FLAG ("--autoplay")
+#define DEFAULT_ACCELERATION (0)
+#define DEFAULT_APPLES (3)
+#define DEFAULT_GRID_DIMENSION (20)
+#define DEFAULT_SOCKET_PATH ("snake.sock")
+#define DEFAULT_TIME_DELAY (150)
+#define SERVER_SEED (2024)
+
+static GameServer server;
+
+// Stop serving so the socket is removed on the way out
+static void handleSignal(int) {
+	server.stop();
+}
+
+/**
+ * Host a game that local clients watch and steer through a Unix domain socket
+ * With --autoplay the snake is steered by the heuristic playout policy on
+ * ticks no client sent a direction
+ * Usage: Server [socket] [rows] [cols] [apples] [delay ms] [--autoplay]
+ */
+int main(int argc, char* argv[]) {
+	std::vector<std::string> args;
+	bool autoplay = false;
+	for (int i = 1; i < argc; i++) {
+		if (std::string(argv[i]) == AUTOPLAY_FLAG) {
+			autoplay = true;
+		} else {
+			args.push_back(argv[i]);
+		}
+	}
+	std::string path = args.size() > 0 ? args[0] : DEFAULT_SOCKET_PATH;
+	int nRows = args.size() > 1 ? atoi(args[1].c_str()) : DEFAULT_GRID_DIMENSION;
+	int nCols = args.size() > 2 ? atoi(args[2].c_str()) : DEFAULT_GRID_DIMENSION;
+	int numApples = args.size() > 3 ? atoi(args[3].c_str()) : DEFAULT_APPLES;
+	int timeDelay = args.size() > 4 ? atoi(args[4].c_str()) : DEFAULT_TIME_DELAY;
+	if (nRows < 1 || nCols < 1 || numApples < 1 || timeDelay < 1 ||
+			(Uint64) nRows * nCols <= (Uint64) numApples) {
+		std::cout << "Usage: " << argv[0] << " [socket] [rows] [cols] [apples]"
+							<< " [delay ms] [" << AUTOPLAY_FLAG << "]\n";
+		return 1;
+	}
+	// A keyframe of a board full of snake must fit in one message
+	if ((Uint64) nRows * nCols * KEYFRAME_CELL_BYTES >
+			MAX_MESSAGE_LENGTH - KEYFRAME_FIXED_BYTES) {
+		std::cout << "A " << nRows << 'x' << nCols
+							<< " board is too large to send to clients\n";
+		return 1;
+	}
+
+	RoundSettings settings = {(Uint32) nRows, (Uint32) nCols, (Uint32) numApples,
+														0, (Uint64) timeDelay, DEFAULT_ACCELERATION};
+	server.setAutoplay(autoplay);
+	if (!server.open(path, settings, SERVER_SEED)) {
+		std::cout << "Unable to listen on " << path << '\n';
+		return 1;
+	}
+	signal(SIGINT, handleSignal);
+	signal(SIGTERM, handleSignal);
+	std::cout << "Serving a " << nRows << 'x' << nCols << " game on " << path
+						<< '\n';
+	server.run();
+	std::cout << server.getTicks() << " ticks, " << server.getBytesSent()
+						<< " bytes sent\n";
+	server.close();
+	return 0;
+}
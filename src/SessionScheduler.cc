@@ -0,0 +1,256 @@
+#include <algorithm>
+#include <chrono>
+#include <coroutine>
+#include <SDL2/SDL.h>
+#include <thread>
+#include <vector>
+
+#include "Rollout.hh"
+#include "SessionScheduler.hh"
+#include "SnakeGame.hh"
+#include "Trace.hh"
+
+// Worker of the pool running on this thread, so a resumed session schedules
+// its next tick without sharing a list with the other workers
+static thread_local int currentWorker = 0;
+
+SessionTask::SessionTask(std::coroutine_handle<promise_type> handle) {
+	_handle = handle;
+}
+
+SessionTask::SessionTask(SessionTask&& other) {
+	_handle = other._handle;
+	other._handle = NULL;
+}
+
+// A task that was never given to a scheduler is destroyed with its coroutine
+SessionTask::~SessionTask() {
+	if (_handle) {
+		_handle.destroy();
+	}
+}
+
+/**
+ * Make a scheduler with no sessions
+ * @param nThreads Number of threads resuming sessions, including the one
+ 									 calling run. 0 uses one thread per core.
+ */
+SessionScheduler::SessionScheduler(int nThreads) : _pool(nThreads) {
+	_start = SDL_GetPerformanceCounter();
+	_ticksPerMs = SDL_GetPerformanceFrequency() / 1000.0;
+	_wheelTime = 0;
+	_nTimers = 0;
+	_scheduled.resize(_pool.getThreadCount());
+	_workerLags.resize(_pool.getThreadCount());
+	_nSessions = 0;
+	_nResumes = 0;
+	_lagsSorted = true;
+}
+
+// Sessions that have not finished are destroyed where they are waiting
+SessionScheduler::~SessionScheduler() {
+	for (std::vector<Timer>& slot : _wheel) {
+		for (Timer& timer : slot) {
+			timer.handle.destroy();
+		}
+	}
+}
+
+/**
+ * Hand a session to the scheduler
+ * @param task The session, which first runs at its start time
+ * @param start Milliseconds after the scheduler was made the session starts
+ */
+void SessionScheduler::spawn(SessionTask task, Uint64 start) {
+	addTimer({start, task._handle});
+	task._handle = NULL;
+	_nSessions++;
+}
+
+/**
+ * Resume sessions as they become due until every session has finished
+ * Sessions due at the same time are resumed in parallel, so a session must
+ * only touch its own state
+ * @param until Milliseconds after the scheduler was made to stop at even if
+ 								some sessions have not finished, they continue on the next run
+ */
+void SessionScheduler::run(Uint64 until) {
+	while (_nSessions > 0) {
+		Uint64 time = now();
+		if (time >= until) {
+			return;
+		}
+		collectDue(time);
+		if (_ready.empty()) {
+			waitForNextTimer();
+			continue;
+		}
+
+		TraceScope trace("resume", "sessions", _ready.size());
+		_pool.run(_ready.size(), [this](int task, int worker) {
+			const Timer& timer = _ready[task];
+			Uint64 due = _start + (Uint64) (timer.deadline * _ticksPerMs);
+			Uint64 lag = SDL_GetPerformanceCounter() - due;
+			_workerLags[worker].push_back(lag / _ticksPerMs * 1000000);
+			currentWorker = worker;
+			timer.handle.resume();
+		});
+		trace.stop();
+
+		for (const Timer& timer : _ready) {
+			if (timer.handle.done()) {
+				timer.handle.destroy();
+				_nSessions--;
+			}
+		}
+		_nResumes += _ready.size();
+		_ready.clear();
+		for (std::vector<Timer>& scheduled : _scheduled) {
+			for (const Timer& timer : scheduled) {
+				addTimer(timer);
+			}
+			scheduled.clear();
+		}
+		for (std::vector<Uint64>& lags : _workerLags) {
+			_lags.insert(_lags.end(), lags.begin(), lags.end());
+			lags.clear();
+		}
+		_lagsSorted = false;
+	}
+}
+
+// Forget the lag of every resume so far
+void SessionScheduler::clearLag() {
+	_lags.clear();
+	_lagsSorted = true;
+}
+
+/**
+ * Suspend the calling session until a deadline, to be used with co_await
+ * @param deadline Milliseconds after the scheduler was made
+ */
+SessionScheduler::TickAwaiter SessionScheduler::sleepUntil(Uint64 deadline) {
+	return {this, deadline};
+}
+
+/**
+ * Queue a session that just suspended, it is added to the wheel once every
+ * worker is done
+ * @param handle The session
+ * @param deadline Milliseconds after the scheduler was made it is due
+ */
+void SessionScheduler::schedule(std::coroutine_handle<> handle,
+																Uint64 deadline) {
+	_scheduled[currentWorker].push_back({deadline, handle});
+}
+
+// Put a session in the slot of its deadline, or the next slot checked if
+// the deadline has passed already
+void SessionScheduler::addTimer(const Timer& timer) {
+	Uint64 time = std::max(timer.deadline, _wheelTime);
+	_wheel[time & (WHEEL_SLOTS - 1)].push_back(timer);
+	_nTimers++;
+}
+
+/**
+ * Move every session due by a time from the wheel to the ready list
+ * Each slot is checked at most once, even after a long stall
+ * @param time Milliseconds after the scheduler was made
+ */
+void SessionScheduler::collectDue(Uint64 time) {
+	if (time < _wheelTime) {
+		return;
+	}
+	Uint64 nSlots = std::min(time - _wheelTime + 1, (Uint64) WHEEL_SLOTS);
+	for (Uint64 i = 0; i < nSlots; i++) {
+		std::vector<Timer>& slot = _wheel[(_wheelTime + i) & (WHEEL_SLOTS - 1)];
+		size_t kept = 0;
+		for (size_t j = 0; j < slot.size(); j++) {
+			if (slot[j].deadline <= time) {
+				_ready.push_back(slot[j]);
+			} else {
+				slot[kept++] = slot[j];
+			}
+		}
+		_nTimers -= slot.size() - kept;
+		slot.resize(kept);
+	}
+	_wheelTime = time + 1;
+}
+
+// Sleep until the start of the next millisecond whose slot holds a session
+void SessionScheduler::waitForNextTimer() {
+	if (_nTimers == 0) {
+		return;
+	}
+	Uint64 next = _wheelTime;
+	while (_wheel[next & (WHEEL_SLOTS - 1)].empty()) {
+		next++;
+	}
+	Uint64 wake = _start + (Uint64) (next * _ticksPerMs);
+	Uint64 current = SDL_GetPerformanceCounter();
+	if (wake > current) {
+		std::this_thread::sleep_for(std::chrono::nanoseconds(
+			(Uint64) ((wake - current) / _ticksPerMs * 1000000)));
+	}
+}
+
+/**
+ * Play rounds back to back, steered by the heuristic playout policy, with
+ * each tick due as long after the last one as in Main: the time delay less
+ * the acceleration for every apple eaten
+ * @param scheduler Scheduler running the session
+ * @param settings Settings every round is played with
+ * @param seed Seed of the first round, each later round uses the next one
+ * @param nTicks Number of ticks the session lasts
+ */
+SessionTask playSession(SessionScheduler* scheduler, RoundSettings settings,
+												Uint64 seed, Uint64 nTicks) {
+	SnakeGame game;
+	Uint64 rng = seed;
+	Uint64 deadline = scheduler->now();
+	for (Uint64 tick = 0; tick < nTicks; tick++) {
+		if (!game.isPlaying()) {
+			game.init(settings.rows, settings.cols, settings.apples, seed++);
+		}
+		game.setDirection(RolloutEvaluator::choose(game, HEURISTIC_POLICY, &rng));
+		game.move();
+
+		Uint64 speedUp = settings.acceleration * (game.getScore() - 1);
+		deadline += settings.timeDelay > speedUp ? settings.timeDelay - speedUp : 1;
+		co_await scheduler->sleepUntil(deadline);
+	}
+}
+
+// Getters
+
+// Milliseconds since the scheduler was made
+Uint64 SessionScheduler::now() const {
+	return (SDL_GetPerformanceCounter() - _start) / _ticksPerMs;
+}
+
+size_t SessionScheduler::getSessionCount() const {
+	return _nSessions;
+}
+
+Uint64 SessionScheduler::getResumeCount() const {
+	return _nResumes;
+}
+
+/**
+ * Find how late sessions were resumed
+ * @param percentile Percentile to find, between 0 and 100
+ * @return Lag in nanoseconds that the given percentage of resumes since the
+ 					 lag was last cleared were within
+ */
+Uint64 SessionScheduler::getLagPercentile(double percentile) {
+	if (_lags.empty()) {
+		return 0;
+	}
+	if (!_lagsSorted) {
+		std::sort(_lags.begin(), _lags.end());
+		_lagsSorted = true;
+	}
+	size_t index = percentile / 100 * (_lags.size() - 1);
+	return _lags[std::min(index, _lags.size() - 1)];
+}
@@ -0,0 +1,131 @@
+#ifndef SESSION_SCHEDULER_HH
+#define SESSION_SCHEDULER_HH
+
+#include <coroutine>
+#include <exception>
+#include <SDL2/SDL.h>
+#include <vector>
+
+#include "GameTypes.hh"
+#include "WorkerPool.hh"
+
+// Slots of the timer wheel, each covering one millisecond, a power of two
+#define WHEEL_SLOTS (1024)
+
+class SessionScheduler;
+
+/**
+ * Coroutine running one session, it does nothing until it is given to a
+ * scheduler, which then owns it
+ */
+class SessionTask {
+	public:
+		struct promise_type {
+			SessionTask get_return_object() {
+				return SessionTask(std::coroutine_handle<promise_type>::from_promise(*this));
+			}
+			std::suspend_always initial_suspend() noexcept {
+				return {};
+			}
+			std::suspend_always final_suspend() noexcept {
+				return {};
+			}
+			void return_void() {}
+			void unhandled_exception() {
+				std::terminate();
+			}
+		};
+
+		SessionTask(SessionTask&&);
+		~SessionTask();
+		SessionTask(const SessionTask&) = delete;
+		SessionTask& operator=(const SessionTask&) = delete;
+
+	private:
+		friend class SessionScheduler;
+
+		explicit SessionTask(std::coroutine_handle<promise_type>);
+
+		std::coroutine_handle<promise_type> _handle;
+};
+
+/**
+ * Runs thousands of sessions on a few threads. Each session is a coroutine
+ * that waits for the deadline of its next tick, the scheduler keeps the
+ * waiting sessions in a timer wheel and resumes those that are due across a
+ * worker pool. How late each one is resumed is kept to report percentiles.
+ */
+class SessionScheduler {
+	public:
+		SessionScheduler(int = 0);
+		~SessionScheduler();
+		SessionScheduler(const SessionScheduler&) = delete;
+		SessionScheduler& operator=(const SessionScheduler&) = delete;
+		void spawn(SessionTask, Uint64);
+		void run(Uint64 = UINT64_MAX);
+		void clearLag();
+
+		// Wait until a number of milliseconds after the scheduler was made
+		struct TickAwaiter {
+			SessionScheduler* scheduler;
+			Uint64 deadline;
+
+			bool await_ready() const noexcept {
+				return false;
+			}
+			void await_suspend(std::coroutine_handle<> handle) const {
+				scheduler->schedule(handle, deadline);
+			}
+			void await_resume() const noexcept {}
+		};
+		TickAwaiter sleepUntil(Uint64);
+
+		// Getters
+		Uint64 now() const;
+		size_t getSessionCount() const;
+		Uint64 getResumeCount() const;
+		Uint64 getLagPercentile(double);
+
+	private:
+		struct Timer {
+			Uint64 deadline; // Milliseconds after the scheduler was made
+			std::coroutine_handle<> handle;
+		};
+
+		WorkerPool _pool;
+
+		// Performance counter when the scheduler was made
+		Uint64 _start;
+		double _ticksPerMs;
+
+		// Waiting sessions in the slot of their deadline, a slot also holds
+		// sessions due whole turns of the wheel later
+		std::vector<Timer> _wheel[WHEEL_SLOTS];
+		Uint64 _wheelTime; // First millisecond whose slot is not checked yet
+		size_t _nTimers;
+
+		// Sessions due now, each resumed by one task of the pool
+		std::vector<Timer> _ready;
+
+		// Sessions each worker scheduled and how late each one it resumed was
+		// in nanoseconds, merged once the workers are done
+		std::vector<std::vector<Timer>> _scheduled;
+		std::vector<std::vector<Uint64>> _workerLags;
+
+		size_t _nSessions;
+		Uint64 _nResumes;
+
+		// Lag of every resume since the lag was last cleared, in nanoseconds,
+		// and whether it is sorted for looking up percentiles
+		std::vector<Uint64> _lags;
+		bool _lagsSorted;
+
+		void schedule(std::coroutine_handle<>, Uint64);
+		void addTimer(const Timer&);
+		void collectDue(Uint64);
+		void waitForNextTimer();
+};
+
+SessionTask playSession(SessionScheduler*, RoundSettings, Uint64, Uint64);
+
+#endif
@@ -1,28 +1,121 @@
+#include <algorithm>
 #include <assert.h>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
-#include <queue>
 #include <SDL2/SDL.h>
 #include <sstream>
 #include <string>
 
+#include "Camera.hh"
+#include "GridRasterizer.hh"
+#include "Metrics.hh"
 #include "SnakeGame.hh"
+#include "Trace.hh"
 
+#define INIT_PATH_CAPACITY (16)
+#define MINIMAP_DIMENSION (128)
+#define MINIMAP_MARGIN (8)
+#define MINIMAP_PIXELS (160)
 #define RIGHT_ANGLE (90)
 
+/**
+ * Zobrist key of a cell holding the given kind of space
+ * Keys are derived by mixing the cell offset instead of being read from a
+ * table, so any board size works without storing keys per cell.
+ * Blank cells have a key of 0 so an empty board hashes to 0.
+ * @param offset Offset of the cell in the grid
+ * @param space What is in the cell
+ * @return The key to be xor-ed into the hash
+ */
+static inline Uint64 zobristKey(Uint64 offset, Spaces space) {
+	if (space == BLANK) {
+		return 0;
+	}
+	Uint64 z = offset * NONE + space + 0x9e3779b97f4a7c15ULL;
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+// Zobrist key of the snake's direction, NONE has a key of 0
+static inline Uint64 directionKey(Direction direction) {
+	return direction == NONE ? 0 : zobristKey(~(Uint64) direction, HEAD);
+}
+
+/**
+ * Zobrist key of a body cell and the direction of the next segment towards
+ * the head, so bodies covering the same cells in a different order, which
+ * free different cells on the next ticks, hash differently
+ * @param offset Offset of the body cell in the grid
+ * @param next Direction from the cell to the next segment
+ * @return The key to be xor-ed into the hash
+ */
+static inline Uint64 segmentKey(Uint64 offset, Direction next) {
+	return zobristKey(~(offset * NONE + next), APPLE);
+}
+
+// Direction from a cell to a neighbouring one
+static inline Direction stepDirection(std::pair<int, int> from,
+																			std::pair<int, int> to) {
+	if (to.first != from.first) {
+		return to.first < from.first ? UP : DOWN;
+	}
+	return to.second < from.second ? LEFT : RIGHT;
+}
+
 // Initialize variables
 SnakeGame::SnakeGame(SDL_Renderer* renderer, SDL_Texture* texture) {
 	_grid = NULL;
+	_gridCapacity = 0;
+	_sparse = false;
+	_nApples = 0;
+	_minimapEnabled = false;
+	_bucketRows = 1;
+	_bucketCols = 1;
+	_minimapRows = 0;
+	_minimapCols = 0;
+	_changeLogEnabled = false;
 	_nRows = 0;
 	_nCols = 0;
 	_currLoc = std::pair(-1, -1);
 	_direction = NONE;
 
+	_path = NULL;
+	_pathCapacity = 0;
+	_pathStart = 0;
+	_pathLength = 0;
+
 	_score = 0;
 	_playing = false;
+	_rngState = 0;
+	_hash = 0;
 
 	_renderer = renderer;
 	_texture = texture;
+	_rasterizer = NULL;
+}
+
+// Copy another game, uses the same renderer and texture as the original
+SnakeGame::SnakeGame(const SnakeGame& other)
+	: SnakeGame(other._renderer, other._texture) {
+	other.clone(*this);
+}
+
+// Copy the state of another game, keeps this game's renderer and texture
+SnakeGame& SnakeGame::operator=(const SnakeGame& other) {
+	if (this != &other) {
+		other.clone(*this);
+	}
+	return *this;
+}
+
+// Storage is only released here, reset keeps it for the next round
+SnakeGame::~SnakeGame() {
+	reset();
+	delete[] _grid;
+	delete[] _path;
 }
 
 /**
@@ -33,20 +126,42 @@ SnakeGame::SnakeGame(SDL_Renderer* renderer, SDL_Texture* texture) {
  * @param numApples: number of apples initially placed on the board
  */
 void SnakeGame::init(int nRows, int nCols, int numApples) {
+	init(nRows, nCols, numApples, ((Uint64) rand() << 32) ^ rand());
+}
+
+/**
+ * Setup the grid to have the given dimensions, placing apples with a
+ * generator seeded by the given value so the game can be reproduced
+ * @param nRows: number of rows in the grid of the new game
+ * @param nCols: number of columns in the grid of the new game
+ * @param numApples: number of apples initially placed on the board
+ * @param seed: initial state of the generator used to place apples
+ */
+void SnakeGame::init(int nRows, int nCols, int numApples, Uint64 seed) {
+	TraceScope trace("init", "rows", nRows, "cols", nCols);
 	reset();
 	// Initialize grid, set current location
+	reserve(nRows, nCols);
 	_nRows = nRows;
 	_nCols = nCols;
-	_grid = (Spaces *) malloc(_nRows * _nCols * sizeof(Spaces));
+	_sparse = (Uint64) nRows * nCols > SPARSE_THRESHOLD;
+	_rngState = seed;
+	_hash = 0;
+	_nApples = 0;
 	_currLoc.first = _nRows / 2;
 	_currLoc.second = _nCols / 2;
+	initMinimap();
 
-	// Set up grid for the start of the game
-	for (int r = 0; r < _nRows; r++) {
-		int offset = r * _nCols;
-		for (int c = 0; c < _nCols; c++) {
-			*(_grid + offset + c) = BLANK;
-			_freeCells.push_back(offset + c);
+	// Set up grid for the start of the game, large boards start out with no
+	// chunks at all and do not keep a list of free cells
+	if (!_sparse) {
+		for (int r = 0; r < _nRows; r++) {
+			int offset = r * _nCols;
+			for (int c = 0; c < _nCols; c++) {
+				*(_grid + offset + c) = BLANK;
+				_freeIndex[offset + c] = _freeCells.size();
+				_freeCells.push_back(offset + c);
+			}
 		}
 	}
 	setCell(_currLoc.first, _currLoc.second, HEAD);
@@ -62,23 +177,377 @@ void SnakeGame::init(int nRows, int nCols, int numApples) {
 }
 
 /**
- * Free any memory associated with an active SnakeGame
  * Reset variables to their initial state
+ * The grid and other buffers are kept so that the next round can reuse them
+ * without allocating, they only grow when a larger board is requested
  */
 void SnakeGame::reset() {
-	if (_grid != NULL) {
-		free(_grid);
+	if (_nRows != 0) {
 		_freeCells.clear();
-		while (!_path.empty()) {
-			_path.pop();
-		}
-		_grid = NULL;
+		_chunks.clear();
+		_occupancy.clear();
+		_changes.clear();
+		_pathStart = 0;
+		_pathLength = 0;
+		_sparse = false;
+		_nApples = 0;
 		_nRows = 0;
 		_nCols = 0;
 		_currLoc = std::pair(-1, -1);
 		_score = 0;
 		_direction = NONE;
+		_playing = false;
+		_hash = 0;
+	}
+}
+
+/**
+ * Make sure the storage of this game can hold a grid of the given size, so
+ * that starting or cloning a game of that size does not need to allocate
+ * @param nRows: number of rows that will fit without reallocating
+ * @param nCols: number of columns that will fit without reallocating
+ */
+void SnakeGame::reserve(int nRows, int nCols) {
+	if ((Uint64) nRows * nCols > SPARSE_THRESHOLD) { // Chunks are made as needed
+		reservePath(INIT_PATH_CAPACITY);
+		return;
+	}
+	int nCells = nRows * nCols;
+	if (nCells > _gridCapacity) {
+		delete[] _grid;
+		_grid = new Spaces[nCells];
+		_gridCapacity = nCells;
+	}
+	_freeCells.reserve(nCells);
+	if (_freeIndex.size() < (size_t) nCells) {
+		_freeIndex.resize(nCells);
+	}
+
+	// The body can never be longer than the grid
+	reservePath(nCells);
+}
+
+/**
+ * Make sure the body can reach the given length without reallocating
+ * @param length: number of cells the body needs to hold
+ */
+void SnakeGame::reservePath(size_t length) {
+	size_t pathCapacity = INIT_PATH_CAPACITY;
+	while (pathCapacity < length) {
+		pathCapacity *= 2;
+	}
+	if (pathCapacity > _pathCapacity) {
+		std::pair<int, int>* newPath = new std::pair<int, int>[pathCapacity];
+		for (size_t i = 0; i < _pathLength; i++) {
+			newPath[i] = _path[(_pathStart + i) & (_pathCapacity - 1)];
+		}
+		delete[] _path;
+		_path = newPath;
+		_pathCapacity = pathCapacity;
+		_pathStart = 0;
+	}
+}
+
+/**
+ * Copy the state of this game into another game, reusing the storage the
+ * other game already has. The other game keeps its own renderer and texture.
+ * Cloning into a game that has reserved enough space does not allocate.
+ * @param dest: game that will be overwritten with the state of this game
+ */
+void SnakeGame::clone(SnakeGame& dest) const {
+	if (_nRows == 0) {
+		// reset only clears the state, so dest keeps the storage it reserved
+		dest.reset();
+		dest._playing = _playing;
+		return;
+	}
+	if (_sparse) {
+		dest._chunks = _chunks;
+		dest._freeCells.clear();
+		dest.reservePath(_pathLength);
+	} else {
+		int nCells = _nRows * _nCols;
+		if (dest._gridCapacity < nCells ||
+				dest._pathCapacity < _pathCapacity) {
+			dest.reserve(_nRows, _nCols);
+		}
+		memcpy(dest._grid, _grid, nCells * sizeof(Spaces));
+		dest._freeCells.assign(_freeCells.begin(), _freeCells.end());
+		memcpy(dest._freeIndex.data(), _freeIndex.data(), nCells * sizeof(int));
+		dest._chunks.clear();
+	}
+
+	// Unroll the body to the start of the destination's ring buffer
+	for (size_t i = 0; i < _pathLength; i++) {
+		dest._path[i] = _path[(_pathStart + i) & (_pathCapacity - 1)];
+	}
+	dest._pathStart = 0;
+	dest._pathLength = _pathLength;
+
+	dest._nRows = _nRows;
+	dest._nCols = _nCols;
+	dest._sparse = _sparse;
+	dest._nApples = _nApples;
+	dest._occupancy.assign(_occupancy.begin(), _occupancy.end());
+	dest._bucketRows = _bucketRows;
+	dest._bucketCols = _bucketCols;
+	dest._minimapRows = _minimapRows;
+	dest._minimapCols = _minimapCols;
+	dest._currLoc = _currLoc;
+	dest._direction = _direction;
+	dest._score = _score;
+	dest._playing = _playing;
+	dest._rngState = _rngState;
+	dest._hash = _hash;
+}
+
+// Fixed size start of a snapshot, followed by the body from the tail to the
+// cell behind the head as (row, column) pairs. Dense boards then store every
+// cell followed by the list of free cells in its current order, so apples
+// land in the same places after resuming. Boards stored in chunks store the
+// (row, column) of each apple instead.
+struct GameSnapshot {
+	Sint32 rows; // 0 when no game is in progress
+	Sint32 cols;
+	Sint32 headRow;
+	Sint32 headCol;
+	Uint32 direction;
+	Uint32 playing;
+	Uint64 score;
+	Uint64 rngState;
+	Uint64 hash;
+	Uint64 nApples;
+	Uint64 pathLength;
+	Uint64 nFree;
+};
+
+// Size in bytes of the snapshot writeSnapshot will make of this game
+size_t SnakeGame::getSnapshotSize() const {
+	if (_nRows == 0) {
+		return sizeof(GameSnapshot);
+	}
+	size_t size = sizeof(GameSnapshot) + _pathLength * sizeof(std::pair<int, int>);
+	if (_sparse) {
+		return size + _nApples * sizeof(std::pair<int, int>);
+	}
+	return size + (size_t) _nRows * _nCols * sizeof(Spaces) +
+				 _freeCells.size() * sizeof(int);
+}
+
+/**
+ * Store the state of this game so it can be resumed later with readSnapshot
+ * Nothing is stored about how the game is drawn
+ * @param dest: buffer of at least getSnapshotSize() bytes
+ */
+void SnakeGame::writeSnapshot(Uint8* dest) const {
+	GameSnapshot snapshot = {_nRows, _nCols, _currLoc.first, _currLoc.second,
+													 (Uint32) _direction, _playing, _score, _rngState,
+													 _hash, _nApples, _pathLength, _freeCells.size()};
+	memcpy(dest, &snapshot, sizeof snapshot);
+	if (_nRows == 0) {
+		return;
+	}
+	dest += sizeof snapshot;
+
+	// Unroll the body, which may wrap around the end of the ring buffer
+	size_t firstPart = std::min(_pathLength, _pathCapacity - _pathStart);
+	memcpy(dest, _path + _pathStart, firstPart * sizeof(std::pair<int, int>));
+	memcpy(dest + firstPart * sizeof(std::pair<int, int>), _path,
+				 (_pathLength - firstPart) * sizeof(std::pair<int, int>));
+	dest += _pathLength * sizeof(std::pair<int, int>);
+
+	if (_sparse) {
+		std::vector<std::pair<Sint64, Sint64>> apples;
+		_chunks.find(APPLE, &apples);
+		for (const std::pair<Sint64, Sint64>& apple : apples) {
+			std::pair<int, int> cell(apple.first, apple.second);
+			memcpy(dest, &cell, sizeof cell);
+			dest += sizeof cell;
+		}
+	} else {
+		size_t nCells = (size_t) _nRows * _nCols;
+		memcpy(dest, _grid, nCells * sizeof(Spaces));
+		memcpy(dest + nCells * sizeof(Spaces), _freeCells.data(),
+					 _freeCells.size() * sizeof(int));
+	}
+}
+
+/**
+ * Restore a game stored by writeSnapshot, reusing this game's storage
+ * The snapshot is checked to be consistent with its own size so a damaged
+ * one can not write outside of the grid, but its contents are trusted
+ * @param src: the snapshot
+ * @param size: size of the snapshot in bytes
+ * @return Whether the snapshot was restored, the game is reset if it was not
+ */
+bool SnakeGame::readSnapshot(const Uint8* src, size_t size) {
+	reset();
+	GameSnapshot snapshot;
+	if (size < sizeof snapshot) {
+		return false;
+	}
+	memcpy(&snapshot, src, sizeof snapshot);
+	if (snapshot.rows == 0) {
+		return size == sizeof snapshot;
+	}
+	Uint64 nCells = (Uint64) snapshot.rows * snapshot.cols;
+	bool sparse = nCells > SPARSE_THRESHOLD;
+	size_t cellSize = sizeof(std::pair<int, int>);
+	if (snapshot.rows < 0 || snapshot.cols <= 0 || snapshot.direction > NONE ||
+			snapshot.headRow < 0 || snapshot.headRow >= snapshot.rows ||
+			snapshot.headCol < 0 || snapshot.headCol >= snapshot.cols ||
+			snapshot.pathLength >= nCells || snapshot.nApples >= nCells ||
+			snapshot.nFree >= nCells || size != sizeof snapshot +
+			snapshot.pathLength * cellSize + (sparse ? snapshot.nApples * cellSize :
+			nCells * sizeof(Spaces) + snapshot.nFree * sizeof(int))) {
+		return false;
+	}
+	const std::pair<int, int>* path = (const std::pair<int, int>*) (src +
+																		sizeof snapshot);
+	const Uint8* rest = src + sizeof snapshot + snapshot.pathLength * cellSize;
+	for (Uint64 i = 0; i < snapshot.pathLength; i++) {
+		std::pair<int, int> cell;
+		memcpy((void*) &cell, path + i, sizeof cell);
+		if (cell.first < 0 || cell.first >= snapshot.rows || cell.second < 0 ||
+				cell.second >= snapshot.cols) {
+			return false;
+		}
+	}
+
+	reserve(snapshot.rows, snapshot.cols);
+	reservePath(snapshot.pathLength);
+	_nRows = snapshot.rows;
+	_nCols = snapshot.cols;
+	_sparse = sparse;
+	_currLoc = std::pair(snapshot.headRow, snapshot.headCol);
+	initMinimap();
+	memcpy((void*) _path, path, snapshot.pathLength * cellSize);
+	_pathStart = 0;
+	_pathLength = snapshot.pathLength;
+
+	if (_sparse) {
+		for (size_t i = 0; i < _pathLength; i++) {
+			setCell(_path[i].first, _path[i].second, BODY);
+		}
+		setCell(_currLoc.first, _currLoc.second, HEAD);
+		for (Uint64 i = 0; i < snapshot.nApples; i++) {
+			std::pair<int, int> apple;
+			memcpy((void*) &apple, rest + i * cellSize, cellSize);
+			if (apple.first < 0 || apple.first >= _nRows || apple.second < 0 ||
+					apple.second >= _nCols) {
+				reset();
+				return false;
+			}
+			setCell(apple.first, apple.second, APPLE);
+		}
+	} else {
+		memcpy(_grid, rest, nCells * sizeof(Spaces));
+		_freeCells.resize(snapshot.nFree);
+		memcpy(_freeCells.data(), rest + nCells * sizeof(Spaces),
+					 snapshot.nFree * sizeof(int));
+		for (size_t i = 0; i < _freeCells.size(); i++) {
+			if (_freeCells[i] < 0 || (Uint64) _freeCells[i] >= nCells) {
+				reset();
+				return false;
+			}
+			_freeIndex[_freeCells[i]] = i;
+		}
+		if (!_occupancy.empty()) {
+			for (size_t i = 0; i < nCells; i++) {
+				if (_grid[i] != BLANK) {
+					updateMinimap(i / _nCols, i % _nCols, BLANK, _grid[i]);
+				}
+			}
+		}
+	}
+
+	_nApples = snapshot.nApples;
+	_direction = (Direction) snapshot.direction;
+	_score = snapshot.score;
+	_playing = snapshot.playing;
+	_rngState = snapshot.rngState;
+	_hash = snapshot.hash;
+	return true;
+}
+
+/**
+ * Choose whether games started from now on keep the downsampled occupancy
+ * buffer the minimap is drawn from. It is off by default since it makes
+ * clones larger.
+ * @param enabled Whether the buffer is kept
+ */
+void SnakeGame::enableMinimap(bool enabled) {
+	_minimapEnabled = enabled;
+}
+
+/**
+ * Choose how the cells are drawn. With a rasterizer they are drawn into a
+ * framebuffer on the CPU, which is much faster on a software renderer.
+ * @param rasterizer Rasterizer drawing for this game's renderer, NULL draws
+										 each cell through SDL
+ */
+void SnakeGame::setRasterizer(GridRasterizer* rasterizer) {
+	_rasterizer = rasterizer;
+}
+
+/**
+ * Choose whether the game logs every cell it changes, so others can follow
+ * the game by applying only what changed. It is off by default.
+ * @param enabled Whether changes are logged
+ */
+void SnakeGame::enableChangeLog(bool enabled) {
+	_changeLogEnabled = enabled;
+	_changes.clear();
+}
+
+// Forget the changes logged so far, keeping the log's storage
+void SnakeGame::clearChanges() {
+	_changes.clear();
+}
+
+/**
+ * List every cell that is not blank, which is enough to rebuild the board
+ * @param cells Vector the cells are added to, in no particular order
+ */
+void SnakeGame::listCells(std::vector<CellChange>* cells) const {
+	if (_nRows == 0) {
+		return;
+	}
+	if (_sparse) {
+		std::vector<std::pair<Sint64, Sint64>> found;
+		for (Spaces value : {HEAD, BODY, APPLE}) {
+			found.clear();
+			_chunks.find(value, &found);
+			for (const std::pair<Sint64, Sint64>& cell : found) {
+				cells->push_back({(Sint32) cell.first, (Sint32) cell.second, value});
+			}
+		}
+		return;
+	}
+	int nCells = _nRows * _nCols;
+	for (int offset = 0; offset < nCells; offset++) {
+		if (_grid[offset] != BLANK) {
+			cells->push_back({offset / _nCols, offset % _nCols, _grid[offset]});
+		}
+	}
+}
+
+// Size and clear the occupancy buffer for the current grid
+void SnakeGame::initMinimap() {
+	_occupancy.clear();
+	if (!_minimapEnabled) {
+		return;
 	}
+	_bucketRows = (_nRows + MINIMAP_DIMENSION - 1) / MINIMAP_DIMENSION;
+	_bucketCols = (_nCols + MINIMAP_DIMENSION - 1) / MINIMAP_DIMENSION;
+	_minimapRows = (_nRows + _bucketRows - 1) / _bucketRows;
+	_minimapCols = (_nCols + _bucketCols - 1) / _bucketCols;
+	_occupancy.assign(_minimapRows * _minimapCols * 2, 0);
+}
+
+// Reseed the generator used to place apples
+void SnakeGame::seed(Uint64 seed) {
+	_rngState = seed;
 }
 
 /**
@@ -90,72 +559,205 @@ void SnakeGame::handleEvent(SDL_Event e) {
 	if (_playing && e.type == SDL_KEYDOWN && e.key.repeat == 0) {
 		SDL_Keycode key	= e.key.keysym.sym;
 		// Set direction depending on the key (wasd or arrows)
-		// Do not allow to move back into itself
-		if ((key == SDLK_UP || key == SDLK_w) &&
-				(_path.empty() ||
-				!coordsEqual(std::pair(_currLoc.first - 1, _currLoc.second), _path.back()))) {
-			_direction = UP;
-		} else if ((key == SDLK_DOWN || key == SDLK_s) &&
-							 (_path.empty() ||
-							 !coordsEqual(std::pair(_currLoc.first + 1, _currLoc.second), _path.back()))) {
-			_direction = DOWN;
-		} else if ((key == SDLK_LEFT || key == SDLK_a) &&
-							 (_path.empty() ||
-							 !coordsEqual(std::pair(_currLoc.first, _currLoc.second - 1), _path.back()))) {
-			_direction = LEFT;
-		} else if ((key == SDLK_RIGHT || key == SDLK_d) &&
-							 (_path.empty() ||
-							 !coordsEqual(std::pair(_currLoc.first, _currLoc.second + 1), _path.back()))) {
-			_direction = RIGHT;
+		Direction direction = NONE;
+		if (key == SDLK_UP || key == SDLK_w) {
+			direction = UP;
+		} else if (key == SDLK_DOWN || key == SDLK_s) {
+			direction = DOWN;
+		} else if (key == SDLK_LEFT || key == SDLK_a) {
+			direction = LEFT;
+		} else if (key == SDLK_RIGHT || key == SDLK_d) {
+			direction = RIGHT;
+		}
+		// Turning back into the body is rejected, which players feel as a
+		// dropped input
+		if (direction != NONE && !setDirection(direction)) {
+			Metrics::add(DROPPED_INPUTS_COUNTER);
 		}
 	}
 }
 
+/**
+ * Change the direction the snake is moving
+ * Do not allow the snake to move back into itself
+ * @param direction The new direction of the snake
+ * @return Whether the direction was changed
+ */
+bool SnakeGame::setDirection(Direction direction) {
+	if (!_playing) {
+		return false;
+	}
+	std::pair<int, int> next = _currLoc;
+	switch (direction) {
+		case UP:
+			next.first--;
+			break;
+		case DOWN:
+			next.first++;
+			break;
+		case LEFT:
+			next.second--;
+			break;
+		case RIGHT:
+			next.second++;
+			break;
+		case NONE:
+			return false;
+	}
+	if (_pathLength > 0 && coordsEqual(next, pathBack())) {
+		return false;
+	}
+	_hash ^= directionKey(_direction) ^ directionKey(direction);
+	_direction = direction;
+	return true;
+}
+
 /**
  * Render the game to the window
  * Each type of block will be a different color rectangle
  * A border will be displayed to outline the grid
+ * Only the cells the camera can see are visited, so the cost depends on the
+ * size of the window and not the size of the grid
+ * @param camera Decides which part of the grid is shown, NULL shows the whole
+ 								 grid if it fits in the window and follows the head otherwise
  */
-void SnakeGame::render() {
+void SnakeGame::render(const Camera* camera) {
 	if (_playing && _renderer != NULL) {
+		TraceScope trace("render");
 		// Rectangle used to render to different portions of the screen
 		SDL_Rect viewport;
 		SDL_RenderGetViewport(_renderer, &viewport);
-		SDL_Rect currSection = {0, 0, viewport.w / _nCols, viewport.h / _nRows};
-		for (int r = 0; r < _nRows; r++) {
-			int offset = r * _nCols;
-			for (int c = 0; c < _nCols; c++) {
-				// Draw square depending on what the space is
-				switch (*(_grid + offset + c)) {
-					case APPLE: // Red for apple
-						SDL_SetRenderDrawColor(_renderer, 0xff, 0, 0, 0xff);
-						break;
-					case BODY:
-					case HEAD: // Green for body / head
-						SDL_SetRenderDrawColor(_renderer, 0, 0xff, 0, 0xff);
-						break;
-					case BLANK: // Black for other spaces
-						SDL_SetRenderDrawColor(_renderer, 0, 0, 0, 0xff);
-						break;
-				}
-				if (_texture != NULL && *(_grid + offset + c) == HEAD) {
-					SDL_RenderCopyEx(_renderer, _texture, NULL, &currSection,
-													 RIGHT_ANGLE * _direction, NULL, SDL_FLIP_NONE);
-				} else {
-					SDL_RenderFillRect(_renderer, &currSection);
-				}
+		Camera stretched;
+		CameraView view = (camera != NULL ? camera : &stretched)->view(viewport, *this);
+		if (_rasterizer == NULL || !_rasterizer->draw(*this, view, viewport)) {
+			renderCells(view);
+		} else if (_texture != NULL) {
+			renderHead(view);
+		}
+
+		bool wholeGrid = view.firstRow == 0 && view.endRow == _nRows &&
+										 view.firstCol == 0 && view.endCol == _nCols;
+		if (camera != NULL && camera->showsMinimap() && !wholeGrid &&
+				!_occupancy.empty()) {
+			renderMinimap(view, viewport);
+		}
+	}
+}
+
+/**
+ * Draw the visible cells one by one, each filled with its color and outlined
+ * @param view The part of the grid shown and where
+ */
+void SnakeGame::renderCells(const CameraView& view) {
+	int startX = view.originX + view.firstCol * view.cellWidth;
+	SDL_Rect currSection = {startX,
+													view.originY + view.firstRow * view.cellHeight,
+													view.cellWidth, view.cellHeight};
+	for (int r = view.firstRow; r < view.endRow; r++) {
+		for (int c = view.firstCol; c < view.endCol; c++) {
+			// Draw square depending on what the space is
+			Spaces space = getCell(r, c);
+			switch (space) {
+				case APPLE: // Red for apple
+					SDL_SetRenderDrawColor(_renderer, 0xff, 0, 0, 0xff);
+					break;
+				case BODY:
+				case HEAD: // Green for body / head
+					SDL_SetRenderDrawColor(_renderer, 0, 0xff, 0, 0xff);
+					break;
+				case BLANK: // Black for other spaces
+					SDL_SetRenderDrawColor(_renderer, 0, 0, 0, 0xff);
+					break;
+			}
+			if (_texture != NULL && space == HEAD) {
+				SDL_RenderCopyEx(_renderer, _texture, NULL, &currSection,
+												 RIGHT_ANGLE * _direction, NULL, SDL_FLIP_NONE);
+			} else {
+				SDL_RenderFillRect(_renderer, &currSection);
+			}
+
+			// Draw gray outline
+			SDL_SetRenderDrawColor(_renderer, 128, 128, 128, 0xff);
+			SDL_RenderDrawRect(_renderer, &currSection);
+
+			currSection.x += currSection.w; // Go to next column
+		}
+		// Go to next row
+		currSection.x = startX;
+		currSection.y += currSection.h;
+	}
+	Metrics::add(DRAW_CALLS_COUNTER, 2 * (Uint64) (view.endRow - view.firstRow) *
+																	 (view.endCol - view.firstCol));
+}
 
-				// Draw gray outline
-				SDL_SetRenderDrawColor(_renderer, 128, 128, 128, 0xff);
-				SDL_RenderDrawRect(_renderer, &currSection);
+/**
+ * Draw the head image over the head's cell, for when the cells were drawn by
+ * the rasterizer
+ * @param view The part of the grid shown and where
+ */
+void SnakeGame::renderHead(const CameraView& view) {
+	int r = _currLoc.first;
+	int c = _currLoc.second;
+	if (r < view.firstRow || r >= view.endRow || c < view.firstCol ||
+			c >= view.endCol) {
+		return;
+	}
+	SDL_Rect section = {view.originX + c * view.cellWidth,
+											view.originY + r * view.cellHeight, view.cellWidth,
+											view.cellHeight};
+	SDL_RenderCopyEx(_renderer, _texture, NULL, &section,
+									 RIGHT_ANGLE * _direction, NULL, SDL_FLIP_NONE);
+	SDL_SetRenderDrawColor(_renderer, 128, 128, 128, 0xff);
+	SDL_RenderDrawRect(_renderer, &section);
+	Metrics::add(DRAW_CALLS_COUNTER, 2);
+}
+
+/**
+ * Draw a small overview of the whole grid in the top right corner from the
+ * occupancy buffer, with an outline around the part the camera shows
+ * @param view The part of the grid shown in the window
+ * @param viewport Area of the window being drawn to
+ */
+void SnakeGame::renderMinimap(const CameraView& view, const SDL_Rect& viewport) {
+	int bucketSize = MINIMAP_PIXELS / std::max(_minimapRows, _minimapCols);
+	if (bucketSize < 1) {
+		bucketSize = 1;
+	}
+	SDL_Rect area = {viewport.w - _minimapCols * bucketSize - MINIMAP_MARGIN,
+									 MINIMAP_MARGIN, _minimapCols * bucketSize,
+									 _minimapRows * bucketSize};
+	SDL_SetRenderDrawColor(_renderer, 0x40, 0x40, 0x40, 0xff);
+	SDL_RenderFillRect(_renderer, &area);
 
-				currSection.x += currSection.w; // Go to next column
+	// Batch the buckets of each color into a single draw call, apples are
+	// drawn second so they stay visible next to the snake
+	for (int kind = 0; kind < 2; kind++) {
+		_minimapRects.clear();
+		for (int b = 0; b < _minimapRows * _minimapCols; b++) {
+			if (_occupancy[b * 2 + kind] > 0) {
+				SDL_Rect rect = {area.x + (b % _minimapCols) * bucketSize,
+												 area.y + (b / _minimapCols) * bucketSize,
+												 bucketSize, bucketSize};
+				_minimapRects.push_back(rect);
 			}
-			// Go to next row
-			currSection.x = 0;
-			currSection.y += currSection.h;
-		}			
+		}
+		if (kind == 0) {
+			SDL_SetRenderDrawColor(_renderer, 0, 0xff, 0, 0xff);
+		} else {
+			SDL_SetRenderDrawColor(_renderer, 0xff, 0, 0, 0xff);
+		}
+		SDL_RenderFillRects(_renderer, _minimapRects.data(), _minimapRects.size());
 	}
+
+	// Outline the cells the camera shows
+	SDL_Rect visible = {
+		area.x + view.firstCol / _bucketCols * bucketSize,
+		area.y + view.firstRow / _bucketRows * bucketSize,
+		std::max(1, (view.endCol - view.firstCol) / _bucketCols * bucketSize),
+		std::max(1, (view.endRow - view.firstRow) / _bucketRows * bucketSize)};
+	SDL_SetRenderDrawColor(_renderer, 0xff, 0xff, 0xff, 0xff);
+	SDL_RenderDrawRect(_renderer, &visible);
+	Metrics::add(DRAW_CALLS_COUNTER, 4);
 }
 
 /**
@@ -169,10 +771,13 @@ bool SnakeGame::move() {
 	if (!_playing) {
 		return true;
 	}
+	TraceScope trace("move");
 	// Adjust position of head
 	if (_direction != NONE) {
 		setCell(_currLoc.first, _currLoc.second, BODY);
-		_path.push(_currLoc);
+		pushPath(_currLoc);
+		_hash ^= segmentKey((Uint64) _currLoc.first * _nCols + _currLoc.second,
+												_direction);
 	}
 	switch (_direction) {
 		case UP:
@@ -204,9 +809,13 @@ bool SnakeGame::move() {
 		_playing = false;
 		return false;
 	} else if (currSpace == BLANK) { // Clear last cell
-		std::pair<int, int> lastLoc = _path.front();
-		_path.pop();
+		std::pair<int, int> lastLoc = popPath();
 		setCell(lastLoc.first, lastLoc.second, BLANK);
+		// The segment after the tail is the new tail, or the head when the body
+		// was one cell long
+		Direction next = _pathLength > 0 ? stepDirection(lastLoc, pathFront()) :
+										 _direction;
+		_hash ^= segmentKey((Uint64) lastLoc.first * _nCols + lastLoc.second, next);
 
 		// Add newly free space to selection for placing an apple
 		addFreeSpace(lastLoc.first, lastLoc.second);
@@ -215,6 +824,7 @@ bool SnakeGame::move() {
 		deleteFreeSpace(_currLoc.first, _currLoc.second);
 	} else if (currSpace == APPLE) { // Increase score/length of snake
 		_score++;
+		_nApples--;
 		if (!placeApple()) { // Place new apple, quit if an apple can't be placed
 			_playing = false;
 			return false;
@@ -232,30 +842,108 @@ bool SnakeGame::move() {
  *				 no space to place an apple.
  */
 bool SnakeGame::placeApple() {
+	TraceScope trace("placeApple");
+	if (_sparse) {
+		return placeSparseApple();
+	}
 	if (_freeCells.empty()) {
 		return false;
 	}
 
-	int index = rand() % _freeCells.size();
-	*(_grid + _freeCells[index]) = APPLE;
-	_freeCells.erase(_freeCells.begin() + index);
+	int offset = _freeCells[nextRandom() % _freeCells.size()];
+	updateMinimap(offset / _nCols, offset % _nCols, BLANK, APPLE);
+	logChange(offset / _nCols, offset % _nCols, APPLE);
+	*(_grid + offset) = APPLE;
+	_hash ^= zobristKey(offset, APPLE);
+	deleteFreeSpace(offset / _nCols, offset % _nCols);
+	_nApples++;
 	return true;
 }
 
+/**
+ * Place an apple on a board stored in chunks by sampling random cells until
+ * a blank one is found. Boards this large are almost entirely blank, so this
+ * takes very few attempts and needs no list of free cells.
+ * @return true if an apple could be placed successfully and false if there is
+ *				 no space to place an apple.
+ */
+bool SnakeGame::placeSparseApple() {
+	Uint64 nCells = (Uint64) _nRows * _nCols;
+	// Head, body and apples are the only cells that are not blank
+	if (1 + _pathLength + _nApples >= nCells) {
+		return false;
+	}
+	while (true) {
+		Uint64 offset = nextRandom() % nCells;
+		int r = offset / _nCols;
+		int c = offset % _nCols;
+		if (_chunks.get(r, c) == BLANK) {
+			setCell(r, c, APPLE);
+			_nApples++;
+			return true;
+		}
+	}
+}
+
+// Advance the apple generator (splitmix64) and return its next value
+Uint64 SnakeGame::nextRandom() {
+	Uint64 z = (_rngState += 0x9e3779b97f4a7c15ULL);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+// Add the cell the head just left to the back of the body
+void SnakeGame::pushPath(std::pair<int, int> loc) {
+	if (_pathLength == _pathCapacity) { // Only large boards grow the body
+		reservePath(_pathCapacity * 2);
+	}
+	_path[(_pathStart + _pathLength) & (_pathCapacity - 1)] = loc;
+	_pathLength++;
+}
+
+// Remove and return the tail of the body
+std::pair<int, int> SnakeGame::popPath() {
+	assert(_pathLength > 0);
+	std::pair<int, int> loc = _path[_pathStart];
+	_pathStart = (_pathStart + 1) & (_pathCapacity - 1);
+	_pathLength--;
+	return loc;
+}
+
+// Tail of the body
+std::pair<int, int> SnakeGame::pathFront() const {
+	assert(_pathLength > 0);
+	return _path[_pathStart];
+}
+
+// Cell of the body directly behind the head
+std::pair<int, int> SnakeGame::pathBack() const {
+	assert(_pathLength > 0);
+	return _path[(_pathStart + _pathLength - 1) & (_pathCapacity - 1)];
+}
+
 // Add an offset indicated by the row and column number to the freeCells array
 void SnakeGame::addFreeSpace(int r, int c) {
+	if (_sparse) {
+		return;
+	}
+	_freeIndex[r * _nCols + c] = _freeCells.size();
 	_freeCells.push_back(r * _nCols + c);
 }
 
 // Remove the offset indicated by the row and column number from the vector
 void SnakeGame::deleteFreeSpace(int r, int c) {
-	int offset = r * _nCols + c;
-	for (size_t i = 0; i < _freeCells.size(); i++) {
-		if (_freeCells[i] == offset) {
-			_freeCells.erase(_freeCells.begin() + i);
-			break;
-		}
+	if (_sparse) {
+		return;
 	}
+	// Move the last free cell into the removed one's place
+	int offset = r * _nCols + c;
+	int index = _freeIndex[offset];
+	int last = _freeCells.back();
+	_freeCells[index] = last;
+	_freeIndex[last] = index;
+	_freeCells.pop_back();
 }
 
 // Check if two sets of coordinates are the same
@@ -266,14 +954,45 @@ inline bool SnakeGame::coordsEqual(std::pair<int, int> coord1,
 
 // Getters
 
-bool SnakeGame::isPlaying() {
+bool SnakeGame::isPlaying() const {
 	return _playing;
 }
 
-Uint64 SnakeGame::getScore() {
+Uint64 SnakeGame::getScore() const {
 	return _score;
 }
 
+int SnakeGame::getRows() const {
+	return _nRows;
+}
+
+int SnakeGame::getCols() const {
+	return _nCols;
+}
+
+std::pair<int, int> SnakeGame::getHead() const {
+	return _currLoc;
+}
+
+Direction SnakeGame::getDirection() const {
+	return _direction;
+}
+
+/**
+ * Zobrist hash of the current position, covering which cells hold the head,
+ * body and apples, the direction of the snake and, for every body cell, the
+ * direction of the next segment, so the order of the body is part of it
+ * @return The hash, updated in constant time on every change to the grid
+ */
+Uint64 SnakeGame::getHash() const {
+	return _hash;
+}
+
+// Cells changed since the change log was last cleared, in order
+const std::vector<CellChange>& SnakeGame::getChanges() const {
+	return _changes;
+}
+
 /**
  * Print a formatted table displaying the contents of the gird
  */
@@ -286,10 +1005,9 @@ void SnakeGame::print() {
 		}
 		result << '\n';
 		for (int r = 0; r < _nRows; r++) {
-			int offset = r * _nCols;
 			result << '|';
 			for (int c = 0; c < _nCols; c++) {
-				switch (*(_grid + offset + c)) {
+				switch (getCell(r, c)) {
 					case HEAD:
 						result << "H,";
 						break;
@@ -310,14 +1028,44 @@ void SnakeGame::print() {
 	}
 }
 
-// Helper method to access particular cell on the grid
-inline Spaces SnakeGame::getCell(int r, int c) {
-	assert(r < _nRows && c < _nCols);
-	return *(_grid + r * _nCols + c);
-}
-
 // Helper method to set a particular cell to a new value
 inline void SnakeGame::setCell(int r, int c, Spaces newVal) {
 	assert(r < _nRows && c < _nCols);
-	*(_grid + r * _nCols + c) = newVal;
+	Uint64 offset = (Uint64) r * _nCols + c;
+	Spaces oldVal = getCell(r, c);
+	_hash ^= zobristKey(offset, oldVal) ^ zobristKey(offset, newVal);
+	updateMinimap(r, c, oldVal, newVal);
+	logChange(r, c, newVal);
+	if (_sparse) {
+		_chunks.set(r, c, newVal);
+	} else {
+		*(_grid + offset) = newVal;
+	}
+}
+
+// Add a cell that is changing to the change log if it is enabled
+inline void SnakeGame::logChange(int r, int c, Spaces newVal) {
+	if (_changeLogEnabled) {
+		_changes.push_back({r, c, newVal});
+	}
+}
+
+/**
+ * Keep the occupancy buffer in step with a cell that is changing
+ * @param r, c Row and column of the cell
+ * @param oldVal What the cell held before
+ * @param newVal What the cell holds now
+ */
+inline void SnakeGame::updateMinimap(int r, int c, Spaces oldVal,
+																		 Spaces newVal) {
+	if (_occupancy.empty()) {
+		return;
+	}
+	int bucket = (r / _bucketRows * _minimapCols + c / _bucketCols) * 2;
+	if (oldVal != BLANK) {
+		_occupancy[bucket + (oldVal == APPLE)]--;
+	}
+	if (newVal != BLANK) {
+		_occupancy[bucket + (newVal == APPLE)]++;
+	}
 }
@@ -1,33 +1,55 @@
-#include <queue>
+#ifndef SNAKE_GAME_HH
+#define SNAKE_GAME_HH
+
+#include <assert.h>
 #include <SDL2/SDL.h>
+#include <utility>
+#include <vector>
 
-enum Spaces {
-	HEAD,
-	BODY,
-	APPLE,
-	BLANK
-};
+#include "Camera.hh"
+#include "ChunkedGrid.hh"
+#include "GameTypes.hh"
 
-enum Direction {
-	DOWN,
-	LEFT,
-	UP,
-	RIGHT,
-	NONE
-};
+// Boards with more cells than this are stored in a ChunkedGrid
+#define SPARSE_THRESHOLD (1 << 22)
+
+class GridRasterizer;
 
 class SnakeGame {
 	public:
 		SnakeGame(SDL_Renderer* = NULL, SDL_Texture* = NULL);
+		SnakeGame(const SnakeGame&);
+		SnakeGame& operator=(const SnakeGame&);
+		~SnakeGame();
 		void init(int, int, int);
+		void init(int, int, int, Uint64);
 		void reset();
+		void reserve(int, int);
+		void clone(SnakeGame&) const;
+		size_t getSnapshotSize() const;
+		void writeSnapshot(Uint8*) const;
+		bool readSnapshot(const Uint8*, size_t);
+		void seed(Uint64);
 		void handleEvent(SDL_Event);
-		void render();
+		bool setDirection(Direction);
+		void render(const Camera* = NULL);
+		void enableMinimap(bool);
+		void setRasterizer(GridRasterizer*);
+		void enableChangeLog(bool);
+		void clearChanges();
+		void listCells(std::vector<CellChange>*) const;
 		bool move();
 		
 		// Getters
-		bool isPlaying();
-		Uint64 getScore();
+		bool isPlaying() const;
+		Uint64 getScore() const;
+		int getRows() const;
+		int getCols() const;
+		std::pair<int, int> getHead() const;
+		Direction getDirection() const;
+		Uint64 getHash() const;
+		const std::vector<CellChange>& getChanges() const;
+		inline Spaces getCell(int, int) const;
 
 		// Methods for testing
 		void print();
@@ -42,6 +64,9 @@ class SnakeGame {
 		// Texture used to display head
 		SDL_Texture* _texture;
 
+		// Draws the cells into a framebuffer instead of one by one when set
+		GridRasterizer* _rasterizer;
+
 		// Dimensions of the grid
 		int _nRows;
 		int _nCols;
@@ -49,28 +74,97 @@ class SnakeGame {
 		// Current location in the grid
 		std::pair<int, int> _currLoc;
 
+		// Number of cells _grid can hold without reallocating
+		int _gridCapacity;
+
+		// Boards larger than SPARSE_THRESHOLD are stored in chunks instead of
+		// _grid and do not keep a list of free cells
+		bool _sparse;
+		ChunkedGrid _chunks;
+
 		// Keep track of the current path of the snake to
 		// easily adjust as it continues to move
-		std::queue< std::pair<int, int> > _path;
+		// Ring buffer from the tail (front) to the cell behind the head (back),
+		// its capacity is always a power of two
+		std::pair<int, int>* _path;
+		size_t _pathCapacity;
+		size_t _pathStart;
+		size_t _pathLength;
 
 		// Keep track of the options for free cells to randomly select
 		std::vector<int> _freeCells;
 
+		// Position of each free cell in _freeCells, so cells can be removed
+		// in constant time by swapping in the last free cell
+		std::vector<int> _freeIndex;
+
+		// Number of apples on the board
+		Uint64 _nApples;
+
+		// Downsampled occupancy of the grid used to draw the minimap. Each
+		// bucket covers _bucketRows x _bucketCols cells and stores the number
+		// of snake cells followed by the number of apples in it. Empty unless
+		// the minimap is enabled.
+		bool _minimapEnabled;
+		std::vector<Uint32> _occupancy;
+		int _bucketRows;
+		int _bucketCols;
+		int _minimapRows;
+		int _minimapCols;
+
+		// Rectangles reused every frame while drawing the minimap
+		std::vector<SDL_Rect> _minimapRects;
+
+		// Every cell changed since the log was last cleared, in the order they
+		// changed. Nothing is logged unless the log is enabled.
+		bool _changeLogEnabled;
+		std::vector<CellChange> _changes;
+
 		// Keep track of the snakes current direction
 		Direction _direction;
 
 		Uint64 _score; // Also serves as length of snake
 
 		bool _playing; // Whether the game has started/finished
+
+		Uint64 _rngState; // State of the generator used to place apples
+
+		// Zobrist hash of the occupied cells, the direction and the order of the
+		// body, kept up to date by setCell, placeApple, setDirection and move
+		Uint64 _hash;
 		
 
+
 		// Helper methods that should only be used while the game is being played
 		bool placeApple();
+		bool placeSparseApple();
+		void reservePath(size_t);
+		void initMinimap();
+		inline void updateMinimap(int, int, Spaces, Spaces);
+		inline void logChange(int, int, Spaces);
+		void renderCells(const CameraView&);
+		void renderHead(const CameraView&);
+		void renderMinimap(const CameraView&, const SDL_Rect&);
+		Uint64 nextRandom();
+		void pushPath(std::pair<int, int>);
+		std::pair<int, int> popPath();
+		std::pair<int, int> pathFront() const;
+		std::pair<int, int> pathBack() const;
 		void addFreeSpace(int, int);
 		void deleteFreeSpace(int, int);
 		inline bool coordsEqual(std::pair<int, int>, std::pair<int, int>);
 
-		// Helper methods to access the grid
-		inline Spaces getCell(int, int);
+		// Helper method to change the grid
 		inline void setCell(int, int, Spaces);
 };
+
+// Helper method to access particular cell on the grid
+inline Spaces SnakeGame::getCell(int r, int c) const {
+	assert(r < _nRows && c < _nCols);
+	if (_sparse) {
+		return _chunks.get(r, c);
+	}
+	return *(_grid + r * _nCols + c);
+}
+
+#endif
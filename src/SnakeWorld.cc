@@ -0,0 +1,451 @@
+#include <algorithm>
+#include <SDL2/SDL.h>
+#include <vector>
+
+#include "SnakeGame.hh"
+#include "SnakeWorld.hh"
+#include "WorkerPool.hh"
+
+// Width and height of the square tiles collisions are resolved in
+#define TILE_DIMENSION (32)
+
+// Number of snakes handled by each task of a parallel phase
+#define SNAKES_PER_TASK (256)
+
+#define INIT_BODY_CAPACITY (4)
+
+// Mix the bits of a value (splitmix64 finalizer)
+static Uint64 mix(Uint64 z) {
+	z += 0x9e3779b97f4a7c15ULL;
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+/**
+ * Create an empty world that many snakes can share
+ * @param nRows Number of rows in the grid
+ * @param nCols Number of columns in the grid
+ * @param nThreads Threads used to advance the world, 0 for one per core.
+ 									 The result of every tick does not depend on it.
+ */
+SnakeWorld::SnakeWorld(int nRows, int nCols, int nThreads) : _pool(nThreads) {
+	_nRows = nRows;
+	_nCols = nCols;
+	_cells.assign(nRows * nCols, EMPTY_CELL);
+	_claims.assign(nRows * nCols, 0);
+	_tilesPerRow = (nCols + TILE_DIMENSION - 1) / TILE_DIMENSION;
+	int tilesPerCol = (nRows + TILE_DIMENSION - 1) / TILE_DIMENSION;
+	_tileStart.assign(_tilesPerRow * tilesPerCol + 1, 0);
+	_nAlive = 0;
+	_numApples = 0;
+	_nApples = 0;
+	_rngState = 0;
+	_ticks = 0;
+}
+
+/**
+ * Clear the world and spawn snakes and apples at random empty cells
+ * @param numSnakes Number of snakes, each starting with a length of one
+ * @param numApples Number of apples kept on the board at all times
+ * @param seed Seed for everything random in the world
+ */
+void SnakeWorld::init(int numSnakes, int numApples, Uint64 seed) {
+	std::fill(_cells.begin(), _cells.end(), EMPTY_CELL);
+	_snakes.clear();
+	_nAlive = 0;
+	_nApples = 0;
+	_ticks = 0;
+	_rngState = seed;
+	for (int i = 0; i < numSnakes; i++) {
+		int cell = randomEmptyCell();
+		if (cell < 0) {
+			break;
+		}
+		addSnake(cell / _nCols, cell % _nCols, (Direction) (nextRandom() % NONE));
+	}
+	_numApples = numApples;
+	placeApples();
+}
+
+/**
+ * Add a snake with a length of one
+ * @param r, c Cell of the snake's head, must be empty
+ * @param direction Direction the snake starts moving in
+ * @return Id of the new snake, -1 if the cell is not empty
+ */
+int SnakeWorld::addSnake(int r, int c, Direction direction) {
+	int cell = r * _nCols + c;
+	if (_cells[cell] != EMPTY_CELL) {
+		return -1;
+	}
+	int id = _snakes.size();
+	Snake snake;
+	snake.body.resize(INIT_BODY_CAPACITY);
+	snake.bodyStart = 0;
+	snake.bodyLength = 0;
+	snake.direction = direction;
+	snake.alive = true;
+	snake.score = 1;
+	snake.rng = mix(_rngState ^ id);
+	snake.target = -1;
+	snake.grows = false;
+	snake.dies = false;
+	_snakes.push_back(snake);
+	pushHead(_snakes.back(), cell);
+	_cells[cell] = id;
+	_nAlive++;
+	return id;
+}
+
+/**
+ * Change the direction of a snake, a snake cannot reverse into its body
+ * @param id The snake
+ * @param direction New direction
+ * @return Whether the direction was changed
+ */
+bool SnakeWorld::setDirection(int id, Direction direction) {
+	Snake& snake = _snakes[id];
+	if (!snake.alive || direction == NONE) {
+		return false;
+	}
+	if (snake.bodyLength > 1) {
+		int neck = snake.body[(snake.bodyStart + snake.bodyLength - 2) &
+													(snake.body.size() - 1)];
+		if (stepCell(head(snake), direction) == neck) {
+			return false;
+		}
+	}
+	snake.direction = direction;
+	return true;
+}
+
+/**
+ * Pick a direction for every living snake: eat an adjacent apple if there
+ * is one, otherwise move randomly to a cell that is empty now
+ */
+void SnakeWorld::steer() {
+	int nTasks = (_snakes.size() + SNAKES_PER_TASK - 1) / SNAKES_PER_TASK;
+	_pool.run(nTasks, [this](int task, int worker) {
+		int end = std::min((int) _snakes.size(), (task + 1) * SNAKES_PER_TASK);
+		for (int id = task * SNAKES_PER_TASK; id < end; id++) {
+			Snake& snake = _snakes[id];
+			if (!snake.alive) {
+				continue;
+			}
+			Direction options[NONE];
+			int nOptions = 0;
+			Direction choice = NONE;
+			for (int d = 0; d < NONE && choice == NONE; d++) {
+				if (snake.bodyLength > 1 && d == (snake.direction + 2) % NONE) {
+					continue;
+				}
+				int next = stepCell(head(snake), (Direction) d);
+				if (next < 0) {
+					continue;
+				} else if (_cells[next] == APPLE_CELL) {
+					choice = (Direction) d;
+				} else if (_cells[next] == EMPTY_CELL) {
+					options[nOptions++] = (Direction) d;
+				}
+			}
+			if (choice == NONE && nOptions > 0) {
+				snake.rng = mix(snake.rng);
+				choice = options[snake.rng % nOptions];
+			}
+			if (choice != NONE) {
+				snake.direction = choice;
+			}
+		}
+	});
+}
+
+/**
+ * Move every living snake one cell at the same time
+ * A snake dies if it leaves the grid, moves into the same cell as another
+ * head, or moves into any body as it was at the start of the tick, except
+ * for tails that move away this tick. Collisions are resolved per tile in
+ * parallel; every phase only reads shared state or writes cells owned by a
+ * single task, so the result does not depend on the number of threads.
+ * @return Number of snakes still alive
+ */
+int SnakeWorld::tick() {
+	int nSnakes = _snakes.size();
+	int nTasks = (nSnakes + SNAKES_PER_TASK - 1) / SNAKES_PER_TASK;
+
+	// Find where every head is going
+	_pool.run(nTasks, [this, nSnakes](int task, int worker) {
+		int end = std::min(nSnakes, (task + 1) * SNAKES_PER_TASK);
+		for (int id = task * SNAKES_PER_TASK; id < end; id++) {
+			Snake& snake = _snakes[id];
+			if (snake.alive) {
+				snake.target = stepCell(head(snake), snake.direction);
+				snake.grows = snake.target >= 0 && _cells[snake.target] == APPLE_CELL;
+				snake.dies = snake.target < 0; // Left the grid
+			}
+		}
+	});
+
+	// Group the snakes by the tile they move into (counting sort by id)
+	int nTiles = _tileStart.size() - 1;
+	std::fill(_tileStart.begin(), _tileStart.end(), 0);
+	for (const Snake& snake : _snakes) {
+		if (snake.alive && snake.target >= 0) {
+			int r = snake.target / _nCols;
+			int c = snake.target % _nCols;
+			_tileStart[(r / TILE_DIMENSION) * _tilesPerRow + c / TILE_DIMENSION + 1]++;
+		}
+	}
+	for (int t = 0; t < nTiles; t++) {
+		_tileStart[t + 1] += _tileStart[t];
+	}
+	_tileSnakes.resize(_tileStart[nTiles]);
+	_tileFill.assign(_tileStart.begin(), _tileStart.end() - 1);
+	for (int id = 0; id < nSnakes; id++) {
+		const Snake& snake = _snakes[id];
+		if (snake.alive && snake.target >= 0) {
+			int r = snake.target / _nCols;
+			int c = snake.target % _nCols;
+			_tileSnakes[_tileFill[(r / TILE_DIMENSION) * _tilesPerRow +
+												c / TILE_DIMENSION]++] = id;
+		}
+	}
+
+	// Resolve collisions, which only marks the snakes that die
+	_pool.run(nTiles, [this](int tile, int worker) {
+		resolveTile(tile);
+	});
+
+	// Remove tails and dead bodies, then place the new heads, each snake only
+	// touches its own cells so this can be split by snake
+	_pool.run(nTasks, [this, nSnakes](int task, int worker) {
+		int end = std::min(nSnakes, (task + 1) * SNAKES_PER_TASK);
+		for (int id = task * SNAKES_PER_TASK; id < end; id++) {
+			Snake& snake = _snakes[id];
+			if (!snake.alive) {
+				continue;
+			}
+			if (snake.dies) {
+				while (snake.bodyLength > 0) {
+					_cells[tail(snake)] = EMPTY_CELL;
+					popTail(snake);
+				}
+			} else if (!snake.grows) {
+				_cells[tail(snake)] = EMPTY_CELL;
+				popTail(snake);
+			}
+		}
+	});
+	_pool.run(nTasks, [this, nSnakes](int task, int worker) {
+		int end = std::min(nSnakes, (task + 1) * SNAKES_PER_TASK);
+		for (int id = task * SNAKES_PER_TASK; id < end; id++) {
+			Snake& snake = _snakes[id];
+			if (snake.alive && !snake.dies) {
+				pushHead(snake, snake.target);
+				_cells[snake.target] = id;
+			}
+		}
+	});
+
+	for (Snake& snake : _snakes) {
+		if (!snake.alive) {
+			continue;
+		}
+		if (snake.dies) {
+			snake.alive = false;
+			_nAlive--;
+		} else if (snake.grows) {
+			snake.score++;
+			_nApples--;
+		}
+	}
+	placeApples();
+	_ticks++;
+	return _nAlive;
+}
+
+/**
+ * Decide which of the snakes moving into a tile survive
+ * Only cells of this tile are written, so tiles can be resolved in parallel
+ * @param tile Index of the tile
+ */
+void SnakeWorld::resolveTile(int tile) {
+	int begin = _tileStart[tile];
+	int end = _tileStart[tile + 1];
+	for (int i = begin; i < end; i++) {
+		_claims[_snakes[_tileSnakes[i]].target]++;
+	}
+	for (int i = begin; i < end; i++) {
+		Snake& snake = _snakes[_tileSnakes[i]];
+		int owner = _cells[snake.target];
+		snake.dies = _claims[snake.target] > 1; // Head to head
+		if (owner >= 0) { // Head to body, moving into a tail that leaves is fine
+			const Snake& other = _snakes[owner];
+			snake.dies = snake.dies || other.grows || tail(other) != snake.target;
+			// Unless the two heads move into each other and meet, which happens
+			// when two snakes one cell long swap places
+			snake.dies = snake.dies || (owner != _tileSnakes[i] &&
+																	other.target == head(snake) &&
+																	snake.target == head(other));
+		}
+	}
+	for (int i = begin; i < end; i++) {
+		_claims[_snakes[_tileSnakes[i]].target] = 0;
+	}
+}
+
+// Advance the world's generator (splitmix64) and return its next value
+Uint64 SnakeWorld::nextRandom() {
+	_rngState += 0x9e3779b97f4a7c15ULL;
+	return mix(_rngState);
+}
+
+/**
+ * Pick a random empty cell, sampling cells until an empty one is found and
+ * falling back to a scan when the board is nearly full
+ * @return Offset of the cell, -1 if there are no empty cells
+ */
+int SnakeWorld::randomEmptyCell() {
+	int nCells = _nRows * _nCols;
+	for (int attempt = 0; attempt < 64; attempt++) {
+		int cell = nextRandom() % nCells;
+		if (_cells[cell] == EMPTY_CELL) {
+			return cell;
+		}
+	}
+	int start = nextRandom() % nCells;
+	for (int i = 0; i < nCells; i++) {
+		int cell = (start + i) % nCells;
+		if (_cells[cell] == EMPTY_CELL) {
+			return cell;
+		}
+	}
+	return -1;
+}
+
+// Add apples until the board holds the requested number again
+void SnakeWorld::placeApples() {
+	while (_nApples < _numApples) {
+		int cell = randomEmptyCell();
+		if (cell < 0) {
+			return;
+		}
+		_cells[cell] = APPLE_CELL;
+		_nApples++;
+	}
+}
+
+// Cell of a snake's head
+int SnakeWorld::head(const Snake& snake) const {
+	return snake.body[(snake.bodyStart + snake.bodyLength - 1) &
+										(snake.body.size() - 1)];
+}
+
+// Cell of a snake's tail, the same as the head for a snake of length one
+int SnakeWorld::tail(const Snake& snake) const {
+	return snake.body[snake.bodyStart];
+}
+
+// Add a new head to a snake, growing its ring buffer when it is full
+void SnakeWorld::pushHead(Snake& snake, int cell) {
+	size_t capacity = snake.body.size();
+	if (snake.bodyLength == capacity) {
+		std::vector<int> body(capacity * 2);
+		for (size_t i = 0; i < snake.bodyLength; i++) {
+			body[i] = snake.body[(snake.bodyStart + i) & (capacity - 1)];
+		}
+		snake.body.swap(body);
+		snake.bodyStart = 0;
+		capacity *= 2;
+	}
+	snake.body[(snake.bodyStart + snake.bodyLength) & (capacity - 1)] = cell;
+	snake.bodyLength++;
+}
+
+// Remove the tail of a snake
+void SnakeWorld::popTail(Snake& snake) {
+	snake.bodyStart = (snake.bodyStart + 1) & (snake.body.size() - 1);
+	snake.bodyLength--;
+}
+
+/**
+ * Cell reached by moving one step from a cell
+ * @param cell Offset of the starting cell
+ * @param direction Direction of the step
+ * @return Offset of the new cell, -1 if it is outside the grid
+ */
+int SnakeWorld::stepCell(int cell, Direction direction) const {
+	int r = cell / _nCols;
+	int c = cell % _nCols;
+	switch (direction) {
+		case UP:
+			r--;
+			break;
+		case DOWN:
+			r++;
+			break;
+		case LEFT:
+			c--;
+			break;
+		case RIGHT:
+			c++;
+			break;
+		case NONE:
+			break;
+	}
+	if (r < 0 || c < 0 || r >= _nRows || c >= _nCols) {
+		return -1;
+	}
+	return r * _nCols + c;
+}
+
+// Getters
+
+int SnakeWorld::getRows() const {
+	return _nRows;
+}
+
+int SnakeWorld::getCols() const {
+	return _nCols;
+}
+
+int SnakeWorld::getSnakeCount() const {
+	return _snakes.size();
+}
+
+int SnakeWorld::getAliveCount() const {
+	return _nAlive;
+}
+
+bool SnakeWorld::isAlive(int id) const {
+	return _snakes[id].alive;
+}
+
+Uint64 SnakeWorld::getScore(int id) const {
+	return _snakes[id].score;
+}
+
+Uint64 SnakeWorld::getTicks() const {
+	return _ticks;
+}
+
+// Owner of a cell: a snake id, EMPTY_CELL or APPLE_CELL
+int SnakeWorld::getCell(int r, int c) const {
+	return _cells[r * _nCols + c];
+}
+
+/**
+ * Hash of the whole world, used to check that runs with different numbers
+ * of threads end in the same state
+ * @return A hash of every cell and every snake's score
+ */
+Uint64 SnakeWorld::checksum() const {
+	Uint64 hash = _ticks;
+	for (int cell : _cells) {
+		hash = mix(hash ^ (Uint32) cell);
+	}
+	for (const Snake& snake : _snakes) {
+		hash = mix(hash ^ snake.score ^ ((Uint64) snake.alive << 63));
+	}
+	return hash;
+}
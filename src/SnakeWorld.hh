@@ -0,0 +1,94 @@
+#ifndef SNAKE_WORLD_HH
+#define SNAKE_WORLD_HH
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+#include "SnakeGame.hh"
+#include "WorkerPool.hh"
+
+// Contents of a cell that no snake occupies, other values are snake ids
+#define EMPTY_CELL (-1)
+#define APPLE_CELL (-2)
+
+class SnakeWorld {
+	public:
+		SnakeWorld(int, int, int = 0);
+		void init(int, int, Uint64);
+		int addSnake(int, int, Direction);
+		bool setDirection(int, Direction);
+		void steer();
+		int tick();
+
+		// Getters
+		int getRows() const;
+		int getCols() const;
+		int getSnakeCount() const;
+		int getAliveCount() const;
+		bool isAlive(int) const;
+		Uint64 getScore(int) const;
+		Uint64 getTicks() const;
+		int getCell(int, int) const;
+		Uint64 checksum() const;
+
+	private:
+		struct Snake {
+			// Ring buffer of cell offsets from the tail to the head,
+			// its capacity is always a power of two
+			std::vector<int> body;
+			size_t bodyStart;
+			size_t bodyLength;
+
+			Direction direction;
+			bool alive;
+			Uint64 score;
+
+			// Generator used when the world steers this snake
+			Uint64 rng;
+
+			// Results of the first phase of a tick
+			int target;   // Cell the head moves into, -1 if out of bounds
+			bool grows;   // Whether the target holds an apple
+			bool dies;    // Whether the snake collides this tick
+		};
+
+		// Owner of each cell: a snake id, EMPTY_CELL or APPLE_CELL
+		std::vector<int> _cells;
+
+		// Scratch count of heads moving into each cell during a tick
+		std::vector<Uint8> _claims;
+
+		int _nRows;
+		int _nCols;
+
+		std::vector<Snake> _snakes;
+		int _nAlive;
+
+		// Number of apples kept on the board
+		int _numApples;
+		int _nApples;
+
+		// Snakes grouped by the tile their head moves into, the ids of tile t
+		// are _tileSnakes[_tileStart[t], _tileStart[t + 1])
+		int _tilesPerRow;
+		std::vector<int> _tileStart;
+		std::vector<int> _tileSnakes;
+		std::vector<int> _tileFill; // Next free slot of each tile while grouping
+
+		Uint64 _rngState; // Generator used to place apples and snakes
+		Uint64 _ticks;
+
+		WorkerPool _pool;
+
+		Uint64 nextRandom();
+		int randomEmptyCell();
+		void placeApples();
+		int head(const Snake&) const;
+		int tail(const Snake&) const;
+		void pushHead(Snake&, int);
+		void popTail(Snake&);
+		int stepCell(int, Direction) const;
+		void resolveTile(int);
+};
+
+#endif
@@ -0,0 +1,193 @@
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <mutex>
+#include <SDL2/SDL.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+
+#include "Checksum.hh"
+#include "SnakeGame.hh"
+#include "Snapshot.hh"
+
+// Offset of the first byte covered by the checksum
+#define CHECKSUM_START (offsetof(SnapshotHeader, checksum) + sizeof(Uint64))
+
+/**
+ * Save a game and its settings to a file through a memory map
+ * The snapshot is written to a temporary file that is flushed to disk and
+ * then replaces the old one, so an interrupted save or a crash leaves the
+ * previous snapshot intact
+ * @param path Path of the snapshot file
+ * @param game The game to save, which may not be in progress
+ * @param gameData Settings saved alongside the game
+ * @param nData Number of settings, at most SNAPSHOT_MAX_DATA
+ * @return Whether the snapshot was saved
+ */
+bool saveSnapshot(const std::string& path, const SnakeGame& game,
+									const Uint64* gameData, int nData) {
+	if (nData > SNAPSHOT_MAX_DATA) {
+		return false;
+	}
+	size_t gameSize = game.getSnapshotSize();
+	size_t size = sizeof(SnapshotHeader) + gameSize;
+	std::string tempPath = path + ".tmp";
+	int fd = open(tempPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		return false;
+	}
+	if (ftruncate(fd, size) != 0) {
+		close(fd);
+		return false;
+	}
+	void* map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED) {
+		close(fd);
+		return false;
+	}
+
+	Uint8* bytes = (Uint8*) map;
+	SnapshotHeader header = {};
+	header.magic = SNAPSHOT_MAGIC;
+	header.version = SNAPSHOT_VERSION;
+	header.gameSize = gameSize;
+	header.nData = nData;
+	memcpy(header.data, gameData, nData * sizeof(Uint64));
+	memcpy(bytes, &header, sizeof header);
+	game.writeSnapshot(bytes + sizeof header);
+	header.checksum = checksum(bytes + CHECKSUM_START, size - CHECKSUM_START);
+	memcpy(bytes + offsetof(SnapshotHeader, checksum), &header.checksum,
+				 sizeof header.checksum);
+
+	// Without the flush a crash after the rename could leave an empty file
+	bool success = munmap(map, size) == 0 && fsync(fd) == 0;
+	close(fd);
+	return success && rename(tempPath.c_str(), path.c_str()) == 0;
+}
+
+/**
+ * Restore a game and its settings saved with saveSnapshot
+ * The file is mapped and checked, then the game is copied straight out of it
+ * @param path Path of the snapshot file
+ * @param game The game to restore into
+ * @param gameData Settings that are overwritten with the saved ones
+ * @param nData Number of settings expected in the snapshot
+ * @return Whether a valid snapshot was found and restored, the settings are
+ 					 unchanged if it was not and the game is reset if it was damaged
+ */
+bool loadSnapshot(const std::string& path, SnakeGame* game, Uint64* gameData,
+									int nData) {
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	struct stat info;
+	if (fstat(fd, &info) != 0 || (size_t) info.st_size < sizeof(SnapshotHeader)) {
+		close(fd);
+		return false;
+	}
+	size_t size = info.st_size;
+	void* map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		return false;
+	}
+
+	const Uint8* bytes = (const Uint8*) map;
+	SnapshotHeader header;
+	memcpy(&header, bytes, sizeof header);
+	bool valid = header.magic == SNAPSHOT_MAGIC &&
+							 header.version == SNAPSHOT_VERSION &&
+							 header.nData == (Uint64) nData &&
+							 header.gameSize == size - sizeof header &&
+							 header.checksum == checksum(bytes + CHECKSUM_START,
+																					 size - CHECKSUM_START);
+	if (valid) {
+		valid = game->readSnapshot(bytes + sizeof header, header.gameSize);
+	}
+	if (valid) {
+		memcpy(gameData, header.data, nData * sizeof(Uint64));
+	}
+	munmap(map, size);
+	return valid;
+}
+
+// Nothing is written until open is called
+SnapshotWriter::SnapshotWriter() {
+	_pending = &_slots[0];
+	_writing = &_slots[1];
+	_hasPending = false;
+	_stopping = false;
+}
+
+SnapshotWriter::~SnapshotWriter() {
+	close();
+}
+
+/**
+ * Start the thread that writes snapshots
+ * @param path Path of the snapshot file
+ */
+void SnapshotWriter::open(const std::string& path) {
+	close();
+	_path = path;
+	_hasPending = false;
+	_stopping = false;
+	_writer = std::thread(&SnapshotWriter::writeLoop, this);
+}
+
+// Write the snapshot still waiting, if any, and stop the thread
+void SnapshotWriter::close() {
+	if (_writer.joinable()) {
+		{
+			std::lock_guard<std::mutex> guard(_pendingLock);
+			_stopping = true;
+		}
+		_wake.notify_one();
+		_writer.join();
+	}
+}
+
+/**
+ * Copy a game and its settings to be saved by the writer thread
+ * Copying into storage kept from earlier saves does not allocate
+ * @param game The game to save, which may not be in progress
+ * @param gameData Settings saved alongside the game
+ * @param nData Number of settings, at most SNAPSHOT_MAX_DATA
+ */
+void SnapshotWriter::save(const SnakeGame& game, const Uint64* gameData,
+													int nData) {
+	if (nData > SNAPSHOT_MAX_DATA) {
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> guard(_pendingLock);
+		game.clone(_pending->game);
+		memcpy(_pending->data, gameData, nData * sizeof(Uint64));
+		_pending->nData = nData;
+		_hasPending = true;
+	}
+	_wake.notify_one();
+}
+
+// Loop run by the writer thread, saving each new snapshot until closed
+void SnapshotWriter::writeLoop() {
+	std::unique_lock<std::mutex> lock(_pendingLock);
+	while (true) {
+		_wake.wait(lock, [this]() { return _stopping || _hasPending; });
+		if (!_hasPending) { // Stopping with nothing left to write
+			return;
+		}
+		std::swap(_pending, _writing);
+		_hasPending = false;
+		lock.unlock();
+
+		saveSnapshot(_path, _writing->game, _writing->data, _writing->nData);
+		lock.lock();
+	}
+}
@@ -0,0 +1,73 @@
+#ifndef SNAPSHOT_HH
+#define SNAPSHOT_HH
+
+#include <condition_variable>
+#include <mutex>
+#include <SDL2/SDL.h>
+#include <string>
+#include <thread>
+
+#include "SnakeGame.hh"
+
+// Identifies snapshot files, and the layout they were written with
+#define SNAPSHOT_MAGIC (0x4b414e53) // "SNAK"
+#define SNAPSHOT_VERSION (2)
+
+// Most game settings a snapshot can hold
+#define SNAPSHOT_MAX_DATA (16)
+
+// Start of every snapshot file, followed by the game's own snapshot
+struct SnapshotHeader {
+	Uint32 magic;
+	Uint32 version;
+	Uint64 gameSize; // Bytes of game snapshot after the header
+	Uint64 checksum; // Of everything after this field
+	Uint64 nData;
+	Uint64 data[SNAPSHOT_MAX_DATA];
+};
+
+bool saveSnapshot(const std::string&, const SnakeGame&, const Uint64*, int);
+bool loadSnapshot(const std::string&, SnakeGame*, Uint64*, int);
+
+/**
+ * Saves snapshots on a background thread so the caller never waits for the
+ * disk, only for a copy of the game
+ * Only the latest snapshot asked for is written, one asked for while another
+ * is being written replaces any that is still waiting.
+ */
+class SnapshotWriter {
+	public:
+		SnapshotWriter();
+		~SnapshotWriter();
+		SnapshotWriter(const SnapshotWriter&) = delete;
+		SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+		void open(const std::string&);
+		void close();
+		void save(const SnakeGame&, const Uint64*, int);
+
+	private:
+		// A copy of a game and its settings to be saved
+		struct Slot {
+			SnakeGame game;
+			Uint64 data[SNAPSHOT_MAX_DATA];
+			int nData;
+		};
+
+		std::string _path;
+
+		// The caller copies into the pending slot and the writer saves from the
+		// other, they are swapped when the writer picks up a new snapshot
+		Slot _slots[2];
+		Slot* _pending;
+		Slot* _writing;
+		bool _hasPending;
+
+		std::mutex _pendingLock;
+		std::condition_variable _wake;
+		bool _stopping;
+		std::thread _writer;
+
+		void writeLoop();
+};
+
+#endif
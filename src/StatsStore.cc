@@ -0,0 +1,283 @@
+#include <condition_variable>
+#include <cstddef>
+#include <cstring>
+#include <fcntl.h>
+#include <mutex>
+#include <SDL2/SDL.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "Checksum.hh"
+#include "StatsStore.hh"
+
+// Whether a log record was written completely and is unchanged since
+static bool isValid(const RoundRecord& record) {
+	return record.magic == STATS_MAGIC && record.version == STATS_VERSION &&
+				 record.checksum == checksum(&record, offsetof(RoundRecord, checksum));
+}
+
+// Whether an index slot was written completely and is unchanged since
+static bool isValid(const StatsIndex& index) {
+	return index.magic == STATS_MAGIC && index.version == STATS_VERSION &&
+				 index.nBests <= STATS_MAX_BESTS &&
+				 index.checksum == checksum(&index, offsetof(StatsIndex, checksum));
+}
+
+static bool sameSettings(const RoundSettings& a, const RoundSettings& b) {
+	return a.rows == b.rows && a.cols == b.cols && a.apples == b.apples &&
+				 a.timeDelay == b.timeDelay && a.acceleration == b.acceleration;
+}
+
+// The store is closed until open is called
+StatsStore::StatsStore() {
+	_logFd = -1;
+	_indexFd = -1;
+	_indexMap = NULL;
+	memset(&_index, 0, sizeof _index);
+	_stopping = false;
+}
+
+StatsStore::~StatsStore() {
+	close();
+}
+
+/**
+ * Open the log and index, creating them if needed, and start the writer
+ * Only the index is read, plus any records appended after it was last
+ * written. The whole log is only read if the index is missing or damaged.
+ * @param logPath Path of the log of every round
+ * @param indexPath Path of the summary index
+ * @return Whether the store could be opened, rounds recorded while it is
+ 					 closed are dropped
+ */
+bool StatsStore::open(const std::string& logPath, const std::string& indexPath) {
+	close();
+	_logFd = ::open(logPath.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+	_indexFd = ::open(indexPath.c_str(), O_RDWR | O_CREAT, 0644);
+	struct stat info;
+	if (_logFd < 0 || _indexFd < 0 || fstat(_indexFd, &info) != 0 ||
+			(info.st_size != 2 * sizeof(StatsIndex) &&
+			 ftruncate(_indexFd, 2 * sizeof(StatsIndex)) != 0)) {
+		close();
+		return false;
+	}
+	void* map = mmap(NULL, 2 * sizeof(StatsIndex), PROT_READ | PROT_WRITE,
+									 MAP_SHARED, _indexFd, 0);
+	if (map == MAP_FAILED) {
+		close();
+		return false;
+	}
+	_indexMap = (StatsIndex*) map;
+
+	// Use the newest slot that is intact, an empty file has neither
+	const StatsIndex* newest = NULL;
+	for (int i = 0; i < 2; i++) {
+		if (isValid(_indexMap[i]) &&
+				(newest == NULL || _indexMap[i].sequence > newest->sequence)) {
+			newest = &_indexMap[i];
+		}
+	}
+	if (newest != NULL) {
+		memcpy(&_index, newest, sizeof _index);
+	} else {
+		memset(&_index, 0, sizeof _index);
+		_index.magic = STATS_MAGIC;
+		_index.version = STATS_VERSION;
+	}
+	if (!recover(newest != NULL ? _index.nRecords : 0)) {
+		close();
+		return false;
+	}
+
+	_stopping = false;
+	_writer = std::thread(&StatsStore::writeLoop, this);
+	return true;
+}
+
+/**
+ * Add the log records the index does not cover yet to it, and drop a record
+ * left half written by a crash so later records stay aligned
+ * @param covered Number of records already in the index
+ * @return Whether the log could be read
+ */
+bool StatsStore::recover(Uint64 covered) {
+	struct stat info;
+	if (fstat(_logFd, &info) != 0) {
+		return false;
+	}
+	Uint64 nRecords = info.st_size / sizeof(RoundRecord);
+	if (nRecords < covered) { // The log lost records the index still counts
+		_index.nRecords = nRecords;
+		covered = nRecords;
+	}
+	Uint64 valid = covered;
+	RoundRecord record;
+	while (valid < nRecords &&
+				 pread(_logFd, &record, sizeof record, valid * sizeof record) ==
+				 sizeof record && isValid(record)) {
+		addToIndex(record);
+		valid++;
+	}
+	if ((Uint64) info.st_size != valid * sizeof(RoundRecord) &&
+			ftruncate(_logFd, valid * sizeof(RoundRecord)) != 0) {
+		return false;
+	}
+	if (valid != covered) {
+		writeIndex();
+	}
+	return true;
+}
+
+/**
+ * Stop the writer after it has written every round recorded so far, then
+ * close the files
+ */
+void StatsStore::close() {
+	if (_writer.joinable()) {
+		{
+			std::lock_guard<std::mutex> guard(_pendingLock);
+			_stopping = true;
+		}
+		_wake.notify_one();
+		_writer.join();
+	}
+	if (_indexMap != NULL) {
+		munmap(_indexMap, 2 * sizeof(StatsIndex));
+		_indexMap = NULL;
+	}
+	if (_logFd >= 0) {
+		::close(_logFd);
+		_logFd = -1;
+	}
+	if (_indexFd >= 0) {
+		::close(_indexFd);
+		_indexFd = -1;
+	}
+}
+
+/**
+ * Queue a finished round to be written, this never waits for the disk
+ * @param settings Settings the round was played with
+ * @param score Final score of the round
+ * @param ticks Number of times the snake moved during the round
+ */
+void StatsStore::record(const RoundSettings& settings, Uint64 score,
+												Uint64 ticks) {
+	if (!_writer.joinable()) {
+		return;
+	}
+	RoundRecord record = {};
+	record.magic = STATS_MAGIC;
+	record.version = STATS_VERSION;
+	record.settings = settings;
+	record.settings.padding = 0;
+	record.score = score;
+	record.ticks = ticks;
+	record.checksum = checksum(&record, offsetof(RoundRecord, checksum));
+	{
+		std::lock_guard<std::mutex> guard(_pendingLock);
+		_pending.push_back(record);
+	}
+	_wake.notify_one();
+}
+
+// Write rounds in batches until the store is closed
+void StatsStore::writeLoop() {
+	std::unique_lock<std::mutex> lock(_pendingLock);
+	while (true) {
+		_wake.wait(lock, [this]() { return _stopping || !_pending.empty(); });
+		if (_pending.empty() && _writing.empty()) { // Stopping, all written
+			return;
+		}
+		// Rounds of a batch that failed are written again with the new ones
+		_writing.insert(_writing.end(), _pending.begin(), _pending.end());
+		_pending.clear();
+		bool stopping = _stopping;
+		lock.unlock();
+
+		// The log is made durable before the index counts its records
+		size_t size = _writing.size() * sizeof(RoundRecord);
+		if (write(_logFd, _writing.data(), size) == (ssize_t) size &&
+				fdatasync(_logFd) == 0) {
+			for (const RoundRecord& record : _writing) {
+				addToIndex(record);
+			}
+			writeIndex();
+			_writing.clear();
+		} else if (ftruncate(_logFd, _index.nRecords * sizeof(RoundRecord)) != 0) {
+			// Any part of the batch that reached the log has to go, or the next
+			// batch would follow a torn record that recover cuts off with it.
+			// If it cannot, nothing more is written.
+			return;
+		}
+		lock.lock();
+		if (stopping && !_writing.empty()) { // The last try failed, give up
+			return;
+		}
+	}
+}
+
+// Fold one round into the summary
+void StatsStore::addToIndex(const RoundRecord& record) {
+	std::lock_guard<std::mutex> guard(_indexLock);
+	_index.nRecords++;
+	if (record.score > _index.highScore) {
+		_index.highScore = record.score;
+	}
+	for (Uint64 i = 0; i < _index.nBests; i++) {
+		if (sameSettings(_index.bests[i].settings, record.settings)) {
+			if (record.score > _index.bests[i].score) {
+				_index.bests[i].score = record.score;
+			}
+			return;
+		}
+	}
+	// Settings past the limit still count toward the high score
+	if (_index.nBests < STATS_MAX_BESTS) {
+		_index.bests[_index.nBests].settings = record.settings;
+		_index.bests[_index.nBests].score = record.score;
+		_index.nBests++;
+	}
+}
+
+// Write the summary over the older of the two slots of the index file
+void StatsStore::writeIndex() {
+	{
+		std::lock_guard<std::mutex> guard(_indexLock);
+		_index.sequence++;
+		_index.checksum = checksum(&_index, offsetof(StatsIndex, checksum));
+		memcpy(&_indexMap[_index.sequence % 2], &_index, sizeof _index);
+	}
+	msync(_indexMap, 2 * sizeof(StatsIndex), MS_SYNC);
+}
+
+// Getters
+
+Uint64 StatsStore::getHighScore() {
+	std::lock_guard<std::mutex> guard(_indexLock);
+	return _index.highScore;
+}
+
+/**
+ * Best score recorded with some settings
+ * @param settings The settings
+ * @return The best score, 0 if no round was recorded with them
+ */
+Uint64 StatsStore::getBest(const RoundSettings& settings) {
+	std::lock_guard<std::mutex> guard(_indexLock);
+	for (Uint64 i = 0; i < _index.nBests; i++) {
+		if (sameSettings(_index.bests[i].settings, settings)) {
+			return _index.bests[i].score;
+		}
+	}
+	return 0;
+}
+
+Uint64 StatsStore::getRoundCount() {
+	std::lock_guard<std::mutex> guard(_indexLock);
+	return _index.nRecords;
+}
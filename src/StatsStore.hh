@@ -0,0 +1,93 @@
+#ifndef STATS_STORE_HH
+#define STATS_STORE_HH
+
+#include <condition_variable>
+#include <mutex>
+#include <SDL2/SDL.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "GameTypes.hh"
+
+#define STATS_MAGIC (0x54415453) // "STAT"
+#define STATS_VERSION (1)
+
+// Most combinations of settings the index keeps a best score for
+#define STATS_MAX_BESTS (1024)
+
+// One finished round as stored in the log
+struct RoundRecord {
+	Uint32 magic;
+	Uint32 version;
+	RoundSettings settings;
+	Uint64 score;
+	Uint64 ticks;
+	Uint64 checksum; // Of every field before it
+};
+
+// Best score for one combination of settings
+struct SettingsBest {
+	RoundSettings settings;
+	Uint64 score;
+};
+
+// Summary of the log, the index file holds two of these and the newer valid
+// one is used, so a crash while writing one leaves the other intact
+struct StatsIndex {
+	Uint32 magic;
+	Uint32 version;
+	Uint64 sequence; // Number of times the index has been written
+	Uint64 nRecords; // Number of log records the summary covers
+	Uint64 highScore;
+	Uint64 nBests;
+	SettingsBest bests[STATS_MAX_BESTS];
+	Uint64 checksum; // Of every field before it
+};
+
+/**
+ * Persistent record of every round played, kept as an append-only log of
+ * checksummed records and a small memory-mapped index of the high score and
+ * the best score for each combination of settings
+ * Rounds are written in batches by a background thread, so recording one
+ * never waits for the disk. Opening the store reads only the index and any
+ * records the index does not cover yet.
+ */
+class StatsStore {
+	public:
+		StatsStore();
+		~StatsStore();
+		bool open(const std::string&, const std::string&);
+		void close();
+		void record(const RoundSettings&, Uint64, Uint64);
+
+		// Getters
+		Uint64 getHighScore();
+		Uint64 getBest(const RoundSettings&);
+		Uint64 getRoundCount();
+
+	private:
+		// Files the log and index are kept in
+		int _logFd;
+		int _indexFd;
+		StatsIndex* _indexMap; // Both slots of the index file
+
+		// Latest summary, only changed by the writer thread
+		StatsIndex _index;
+		std::mutex _indexLock;
+
+		// Rounds waiting to be written and the thread writing them
+		std::vector<RoundRecord> _pending;
+		std::vector<RoundRecord> _writing;
+		std::mutex _pendingLock;
+		std::condition_variable _wake;
+		bool _stopping;
+		std::thread _writer;
+
+		void writeLoop();
+		void writeIndex();
+		bool recover(Uint64);
+		void addToIndex(const RoundRecord&);
+};
+
+#endif
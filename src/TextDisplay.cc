@@ -3,7 +3,10 @@
 #include <SDL2/SDL_ttf.h>
 #include <string>
 
+#include "GlyphCache.hh"
+#include "Metrics.hh"
 #include "TextDisplay.hh"
+#include "Trace.hh"
 
 // Initialize all variables to NULL, will need to be set later to actually use
 TextDisplay::TextDisplay() {
@@ -12,38 +15,51 @@ TextDisplay::TextDisplay() {
 	textTexture = NULL;
 	_font = NULL;
 	_renderer = NULL;
+	_glyphs = NULL;
 }
 
-// Initialize variables to be ready to load text from the given font
-TextDisplay::TextDisplay(TTF_Font* font, SDL_Renderer* renderer) {
+// Initialize variables to be ready to load text from the given font, or from
+// the glyph cache when given one, in which case the font may be NULL
+TextDisplay::TextDisplay(TTF_Font* font, SDL_Renderer* renderer,
+												 const GlyphCache* glyphs) {
 	_width = 0;
 	_height = 0;
 	textTexture = NULL;
 
 	_font = font;
 	_renderer = renderer;
+	_glyphs = glyphs;
 }
 
 /**
  * Load given string into the texture to be renderered
- * Text will have font that the texture was initialized with
+ * Text will have font that the texture was initialized with, and is copied
+ * from the glyph cache instead of drawn with the font when it can be
  * @param text Text that will be displayed
  * @param color Color that the text will appear in
  * @return Whether the texture was successfully created or not
  */
 bool TextDisplay::loadText(std::string text, SDL_Color color) {
+	TraceScope trace("loadText");
 	free();
 	if (_renderer == NULL) {
 		std::cout << "No renderer was given to render text\n";
 		return false;
 	}
 
-	if (_font == NULL) {
+	bool cached = _glyphs != NULL && _glyphs->covers(text);
+	if (_font == NULL && !cached) {
 		std::cout << "No font was given to render text\n";
 		return false;
 	}
 
-	SDL_Surface* textSurface = TTF_RenderText_Solid(_font, text.c_str(), color);
+	SDL_Surface* textSurface;
+	if (cached) {
+		textSurface = _glyphs->renderText(text, color);
+	} else {
+		Metrics::add(TEXT_LOADS_COUNTER);
+		textSurface = TTF_RenderText_Solid(_font, text.c_str(), color);
+	}
 	if (textSurface == NULL) {
 		std::cout << "Text Surface Creation Error: " << TTF_GetError() << '\n';
 		return false;
@@ -70,6 +86,7 @@ void TextDisplay::render(int x, int y) {
 	if (_renderer != NULL && textTexture != NULL) {
 		SDL_Rect rect = {x, y, _width, _height};
 		SDL_RenderCopy(_renderer, textTexture, NULL, &rect);
+		Metrics::add(DRAW_CALLS_COUNTER);
 	}
 }
 
@@ -2,10 +2,12 @@
 #include <SDL2/SDL_ttf.h>
 #include <string>
 
+#include "GlyphCache.hh"
+
 class TextDisplay {
 	public:
 		TextDisplay();
-		TextDisplay(TTF_Font*, SDL_Renderer*);
+		TextDisplay(TTF_Font*, SDL_Renderer*, const GlyphCache* = NULL);
 		bool loadText(std::string, SDL_Color);
 		void render(int, int);
 		void free();
@@ -19,6 +21,10 @@ class TextDisplay {
 		TTF_Font* _font;
 		SDL_Renderer* _renderer;
 
+		// Characters drawn ahead of time, used instead of the font when it
+		// holds every character of a line
+		const GlyphCache* _glyphs;
+
 		// Dimensions of text data
 		int _width;
 		int _height;
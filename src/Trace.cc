@@ -0,0 +1,181 @@
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <SDL2/SDL.h>
+#include <string>
+#include <vector>
+
+#include "Trace.hh"
+
+// Ring buffer of the events recorded by one thread
+// Only the owning thread writes, the count is published so a writer of the
+// trace sees every event stored before it
+struct TraceBuffer {
+	TraceEvent events[TRACE_BUFFER_EVENTS];
+	std::atomic<Uint64> written;
+	int threadId;
+};
+
+std::atomic<bool> Tracer::_enabled(false);
+
+// Every buffer ever created, and those whose thread has exited so a new
+// thread can take them over. The lock is only taken when a thread records
+// its first event or exits.
+static std::mutex buffersLock;
+static std::vector<std::unique_ptr<TraceBuffer>> buffers;
+static std::vector<TraceBuffer*> freeBuffers;
+
+// Counter value timestamps are measured from
+static Uint64 traceStart = 0;
+
+static thread_local TraceBuffer* threadBuffer = NULL;
+
+// Hands the calling thread's buffer back when the thread exits, so threads
+// that come and go reuse a few buffers instead of each leaving one behind.
+// Kept apart from threadBuffer so recording an event stays a plain load.
+struct BufferReturn {
+	TraceBuffer* buffer = NULL;
+
+	~BufferReturn() {
+		if (buffer != NULL) {
+			std::lock_guard<std::mutex> guard(buffersLock);
+			freeBuffers.push_back(buffer);
+			threadBuffer = NULL;
+		}
+	}
+};
+
+static thread_local BufferReturn bufferReturn;
+
+/**
+ * Buffer of the calling thread, taken over from an exited thread or created
+ * the first time it records an event
+ * A buffer taken over keeps the earlier thread's events, which are written
+ * out under the same thread id
+ */
+static TraceBuffer* getBuffer() {
+	if (threadBuffer == NULL) {
+		std::lock_guard<std::mutex> guard(buffersLock);
+		if (!freeBuffers.empty()) {
+			threadBuffer = freeBuffers.back();
+			freeBuffers.pop_back();
+		} else {
+			std::unique_ptr<TraceBuffer> buffer(new TraceBuffer());
+			buffer->written.store(0, std::memory_order_relaxed);
+			buffer->threadId = buffers.size();
+			threadBuffer = buffer.get();
+			buffers.push_back(std::move(buffer));
+		}
+		bufferReturn.buffer = threadBuffer;
+	}
+	return threadBuffer;
+}
+
+// Store an event in the calling thread's ring buffer
+static inline void record(char phase, const char* name, const char* arg0,
+													Sint64 value0, const char* arg1, Sint64 value1) {
+	TraceBuffer* buffer = getBuffer();
+	Uint64 index = buffer->written.load(std::memory_order_relaxed);
+	TraceEvent& event = buffer->events[index % TRACE_BUFFER_EVENTS];
+	event.name = name;
+	event.argNames[0] = arg0;
+	event.argValues[0] = value0;
+	event.argNames[1] = arg1;
+	event.argValues[1] = value1;
+	event.counter = SDL_GetPerformanceCounter();
+	event.phase = phase;
+	buffer->written.store(index + 1, std::memory_order_release);
+}
+
+/**
+ * Start or stop recording, events recorded earlier are kept
+ * @param enabled Whether spans should be recorded
+ */
+void Tracer::setEnabled(bool enabled) {
+	if (enabled && traceStart == 0) {
+		traceStart = SDL_GetPerformanceCounter();
+	}
+	_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+/**
+ * Record the start of a span on the calling thread
+ * @param name Name of the span
+ * @param arg0 Name of the first argument shown with the span or NULL
+ * @param value0 Value of the first argument
+ * @param arg1 Name of the second argument shown with the span or NULL
+ * @param value1 Value of the second argument
+ */
+void Tracer::begin(const char* name, const char* arg0, Sint64 value0,
+									 const char* arg1, Sint64 value1) {
+	record('B', name, arg0, value0, arg1, value1);
+}
+
+/**
+ * Record the end of the span most recently begun on the calling thread
+ * @param name Name of the span
+ */
+void Tracer::end(const char* name) {
+	record('E', name, NULL, 0, NULL, 0);
+}
+
+/**
+ * Write every buffered event as a Chrome trace JSON file
+ * Threads should not be recording while this runs
+ * @param path Path of the file, which is overwritten
+ * @return Whether the file was written
+ */
+bool Tracer::write(const std::string& path) {
+	std::ofstream file(path);
+	if (!file) {
+		return false;
+	}
+	double usPerTick = 1e6 / SDL_GetPerformanceFrequency();
+	file.setf(std::ios::fixed);
+	file.precision(3);
+	std::lock_guard<std::mutex> guard(buffersLock);
+
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	bool first = true;
+	for (const std::unique_ptr<TraceBuffer>& buffer : buffers) {
+		if (!first) {
+			file << ",\n";
+		}
+		first = false;
+		file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+				 << buffer->threadId << ",\"args\":{\"name\":\""
+				 << (buffer->threadId == 0 ? "main" : "worker") << "\"}}";
+
+		Uint64 written = buffer->written.load(std::memory_order_acquire);
+		Uint64 oldest = written > TRACE_BUFFER_EVENTS ?
+										written - TRACE_BUFFER_EVENTS : 0;
+		// Ends whose beginning was overwritten would confuse the viewer
+		int depth = 0;
+		for (Uint64 i = oldest; i < written; i++) {
+			const TraceEvent& event = buffer->events[i % TRACE_BUFFER_EVENTS];
+			if (event.phase == 'E') {
+				if (depth == 0) {
+					continue;
+				}
+				depth--;
+			} else {
+				depth++;
+			}
+			file << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"" << event.phase
+					 << "\",\"ts\":" << (Sint64) (event.counter - traceStart) * usPerTick
+					 << ",\"pid\":1,\"tid\":" << buffer->threadId;
+			if (event.argNames[0] != NULL) {
+				file << ",\"args\":{\"" << event.argNames[0] << "\":"
+						 << event.argValues[0];
+				if (event.argNames[1] != NULL) {
+					file << ",\"" << event.argNames[1] << "\":" << event.argValues[1];
+				}
+				file << '}';
+			}
+			file << '}';
+		}
+	}
+	file << "\n]}\n";
+	return (bool) file;
+}
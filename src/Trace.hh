@@ -0,0 +1,74 @@
+#ifndef TRACE_HH
+#define TRACE_HH
+
+#include <atomic>
+#include <SDL2/SDL.h>
+#include <string>
+
+// Events each thread keeps before the oldest are overwritten
+#define TRACE_BUFFER_EVENTS (1 << 16)
+
+// Arguments that can be attached to the start of a span
+#define TRACE_ARGS (2)
+
+// One begin or end of a span, names must be string literals
+struct TraceEvent {
+	const char* name;
+	const char* argNames[TRACE_ARGS];
+	Sint64 argValues[TRACE_ARGS];
+	Uint64 counter;
+	char phase;
+};
+
+/**
+ * Records spans of time from any thread and writes them out as Chrome trace
+ * JSON, which chrome://tracing and Perfetto can open
+ * Each thread writes only into its own ring buffer so recording takes no locks
+ */
+class Tracer {
+	public:
+		static void setEnabled(bool);
+		static inline bool isEnabled() {
+			return _enabled.load(std::memory_order_relaxed);
+		}
+		static void begin(const char*, const char* = NULL, Sint64 = 0,
+											const char* = NULL, Sint64 = 0);
+		static void end(const char*);
+		static bool write(const std::string&);
+
+	private:
+		static std::atomic<bool> _enabled;
+};
+
+// Trace the enclosing scope as a span while the tracer is enabled
+class TraceScope {
+	public:
+		TraceScope(const char* name, const char* arg0 = NULL, Sint64 value0 = 0,
+							 const char* arg1 = NULL, Sint64 value1 = 0) {
+			_name = NULL;
+			if (Tracer::isEnabled()) {
+				_name = name;
+				Tracer::begin(name, arg0, value0, arg1, value1);
+			}
+		}
+
+		~TraceScope() {
+			stop();
+		}
+
+		// End the span early, for spans that finish before the scope does
+		void stop() {
+			if (_name != NULL) {
+				Tracer::end(_name);
+				_name = NULL;
+			}
+		}
+
+		TraceScope(const TraceScope&) = delete;
+		TraceScope& operator=(const TraceScope&) = delete;
+
+	private:
+		const char* _name;
+};
+
+#endif
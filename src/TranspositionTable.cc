@@ -0,0 +1,87 @@
+#include <atomic>
+#include <cstring>
+#include <SDL2/SDL.h>
+
+#include "SnakeGame.hh"
+#include "TranspositionTable.hh"
+
+#define DEPTH_SHIFT (32)
+#define MOVE_SHIFT (40)
+
+/**
+ * Allocate a table with a fixed number of entries that can be shared by
+ * any number of search threads without locking
+ * @param log2Entries The table will hold 2^log2Entries entries
+ */
+TranspositionTable::TranspositionTable(int log2Entries) {
+	size_t size = (size_t) 1 << log2Entries;
+	_entries = new Entry[size];
+	_mask = size - 1;
+	clear();
+}
+
+TranspositionTable::~TranspositionTable() {
+	delete[] _entries;
+}
+
+/**
+ * Look up a position that may have been searched before
+ * @param hash Zobrist hash of the position
+ * @param depth Number of moves that still need to be searched from here
+ * @param value Receives the stored value if the entry is usable
+ * @param move Receives the best move found for the position
+ * @return Whether the position was found, searched to at least depth
+ */
+bool TranspositionTable::probe(Uint64 hash, int depth, float* value,
+															 Direction* move) const {
+	const Entry& entry = _entries[hash & _mask];
+	Uint64 data = entry.data.load(std::memory_order_relaxed);
+	Uint64 check = entry.check.load(std::memory_order_relaxed);
+	if ((check ^ data) != hash || data == 0) {
+		return false;
+	}
+	if ((int) ((data >> DEPTH_SHIFT) & 0xff) < depth) {
+		return false;
+	}
+	Uint32 valueBits = (Uint32) data;
+	memcpy(value, &valueBits, sizeof(float));
+	*move = (Direction) ((data >> MOVE_SHIFT) & 0xff);
+	return true;
+}
+
+/**
+ * Record the result of searching a position, replacing whatever was in
+ * its slot
+ * @param hash Zobrist hash of the position
+ * @param depth Number of moves that were searched from the position
+ * @param value Value found for the position
+ * @param move Best move found for the position
+ */
+void TranspositionTable::store(Uint64 hash, int depth, float value,
+															 Direction move) {
+	Uint32 valueBits;
+	memcpy(&valueBits, &value, sizeof(float));
+	if (depth > 0xff) {
+		depth = 0xff;
+	}
+	// A marker bit keeps the data of a used entry from ever being 0
+	Uint64 data = valueBits | ((Uint64) depth << DEPTH_SHIFT) |
+								((Uint64) move << MOVE_SHIFT) | ((Uint64) 1 << 48);
+	Entry& entry = _entries[hash & _mask];
+	entry.check.store(hash ^ data, std::memory_order_relaxed);
+	entry.data.store(data, std::memory_order_relaxed);
+}
+
+// Forget every stored position
+void TranspositionTable::clear() {
+	for (size_t i = 0; i <= _mask; i++) {
+		_entries[i].check.store(0, std::memory_order_relaxed);
+		_entries[i].data.store(0, std::memory_order_relaxed);
+	}
+}
+
+// Getters
+
+size_t TranspositionTable::getSize() const {
+	return _mask + 1;
+}
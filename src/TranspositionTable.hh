@@ -0,0 +1,36 @@
+#ifndef TRANSPOSITION_TABLE_HH
+#define TRANSPOSITION_TABLE_HH
+
+#include <atomic>
+#include <SDL2/SDL.h>
+
+#include "SnakeGame.hh"
+
+class TranspositionTable {
+	public:
+		TranspositionTable(int);
+		~TranspositionTable();
+		TranspositionTable(const TranspositionTable&) = delete;
+		TranspositionTable& operator=(const TranspositionTable&) = delete;
+		bool probe(Uint64, int, float*, Direction*) const;
+		void store(Uint64, int, float, Direction);
+		void clear();
+
+		// Getters
+		size_t getSize() const;
+
+	private:
+		// The key is stored xor-ed with the data so that an entry torn by two
+		// threads writing at once fails verification instead of being trusted
+		struct Entry {
+			std::atomic<Uint64> check;
+			std::atomic<Uint64> data;
+		};
+
+		Entry* _entries;
+
+		// Number of entries minus one, the number of entries is a power of two
+		size_t _mask;
+};
+
+#endif
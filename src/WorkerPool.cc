@@ -0,0 +1,109 @@
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <SDL2/SDL.h>
+#include <thread>
+#include <vector>
+
+#include "WorkerPool.hh"
+
+/**
+ * Start a fixed set of threads that wait for work
+ * @param nThreads Total number of threads doing work, including the thread
+ 									 calling run. 0 uses one thread per core.
+ */
+WorkerPool::WorkerPool(int nThreads) {
+	if (nThreads <= 0) {
+		nThreads = std::thread::hardware_concurrency();
+	}
+	if (nThreads <= 0) {
+		nThreads = 1;
+	}
+	_task = NULL;
+	_nTasks = 0;
+	_nextTask = 0;
+	_generation = 0;
+	_nBusy = 0;
+	_quit = false;
+	for (int i = 1; i < nThreads; i++) {
+		_threads.emplace_back(&WorkerPool::work, this, i);
+	}
+}
+
+WorkerPool::~WorkerPool() {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_quit = true;
+	}
+	_start.notify_all();
+	for (std::thread& thread : _threads) {
+		thread.join();
+	}
+}
+
+/**
+ * Run a task for every index in [0, nTasks) across the pool and wait until
+ * all of them are finished. Tasks are handed out one at a time, so which
+ * worker runs which task is not fixed.
+ * @param nTasks Number of tasks
+ * @param task Called with the task index and the index of the worker
+ 							 running it (0 is the caller)
+ */
+void WorkerPool::run(int nTasks, const std::function<void(int, int)>& task) {
+	if (_threads.empty() || nTasks <= 1) {
+		for (int i = 0; i < nTasks; i++) {
+			task(i, 0);
+		}
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_task = &task;
+		_nTasks = nTasks;
+		_nextTask.store(0, std::memory_order_relaxed);
+		_nBusy = _threads.size();
+		_generation++;
+	}
+	_start.notify_all();
+	drain(0);
+
+	std::unique_lock<std::mutex> lock(_mutex);
+	_done.wait(lock, [this] { return _nBusy == 0; });
+	_task = NULL;
+}
+
+// Loop run by each thread of the pool, waiting for work between runs
+void WorkerPool::work(int worker) {
+	Uint64 seen = 0;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_start.wait(lock, [this, seen] { return _quit || _generation != seen; });
+			if (_quit) {
+				return;
+			}
+			seen = _generation;
+		}
+		drain(worker);
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_nBusy--;
+		}
+		_done.notify_one();
+	}
+}
+
+// Take tasks of the current run until there are none left
+void WorkerPool::drain(int worker) {
+	int i;
+	while ((i = _nextTask.fetch_add(1, std::memory_order_relaxed)) < _nTasks) {
+		(*_task)(i, worker);
+	}
+}
+
+// Getters
+
+int WorkerPool::getThreadCount() const {
+	return _threads.size() + 1;
+}
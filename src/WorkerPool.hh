@@ -0,0 +1,45 @@
+#ifndef WORKER_POOL_HH
+#define WORKER_POOL_HH
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <SDL2/SDL.h>
+#include <thread>
+#include <vector>
+
+class WorkerPool {
+	public:
+		WorkerPool(int = 0);
+		~WorkerPool();
+		WorkerPool(const WorkerPool&) = delete;
+		WorkerPool& operator=(const WorkerPool&) = delete;
+		void run(int, const std::function<void(int, int)>&);
+
+		// Getters
+		int getThreadCount() const;
+
+	private:
+		// Threads other than the caller of run, which also does work
+		std::vector<std::thread> _threads;
+
+		std::mutex _mutex;
+		std::condition_variable _start;
+		std::condition_variable _done;
+
+		// Work of the current call to run
+		const std::function<void(int, int)>* _task;
+		int _nTasks;
+		std::atomic<int> _nextTask;
+
+		// Incremented for every call to run so sleeping threads notice new work
+		Uint64 _generation;
+		int _nBusy;
+		bool _quit;
+
+		void work(int);
+		void drain(int);
+};
+
+#endif
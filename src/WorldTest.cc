@@ -0,0 +1,74 @@
+#include <iostream>
+#include <SDL2/SDL.h>
+
+#include "SnakeGame.hh"
+#include "SnakeWorld.hh"
+
+// Seed that spawns a snake at (0, 0) of a 3x2 world with an apple at (0, 1),
+// and places the next apple at (1, 1)
+#define ROTATION_SEED (284)
+
+/**
+ * Check that two snakes one cell long moving into each other both die
+ * @return Whether the world gave the expected result
+ */
+bool checkSwap() {
+	SnakeWorld world(1, 2, 1);
+	world.init(0, 0, 0);
+	int a = world.addSnake(0, 0, RIGHT);
+	int b = world.addSnake(0, 1, LEFT);
+	world.tick();
+	if (world.isAlive(a) || world.isAlive(b)) {
+		std::cout << "FAIL: swap gave A alive=" << world.isAlive(a) << " B alive="
+							<< world.isAlive(b) << ", expected 0 0\n";
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Check that snakes following each other around a 2x2 square all survive
+ * B is an L of length 3 from (0, 0) through (0, 1) to its head at (1, 1) and
+ * A is one cell long at (1, 0). A moves into B's tail as it leaves while B
+ * moves into the cell A leaves, so the heads never meet.
+ * @return Whether the world gave the expected result
+ */
+bool checkRotation() {
+	SnakeWorld world(3, 2, 1);
+	world.init(1, 1, ROTATION_SEED);
+	int b = 0;
+	int a = world.addSnake(2, 1, LEFT);
+
+	// B eats its way into the L while A comes around to (1, 0)
+	world.setDirection(b, RIGHT);
+	world.tick();
+	world.setDirection(b, DOWN);
+	world.setDirection(a, UP);
+	world.tick();
+	if (world.getCell(0, 0) != b || world.getCell(0, 1) != b ||
+			world.getCell(1, 1) != b || world.getCell(1, 0) != a) {
+		std::cout << "FAIL: rotation could not be set up from seed "
+							<< ROTATION_SEED << '\n';
+		return false;
+	}
+
+	world.setDirection(b, LEFT);
+	world.tick();
+	if (!world.isAlive(a) || !world.isAlive(b)) {
+		std::cout << "FAIL: rotation gave A alive=" << world.isAlive(a)
+							<< " B alive=" << world.isAlive(b) << ", expected 1 1\n";
+		return false;
+	}
+	return true;
+}
+
+// Check collisions in small worlds whose outcome is known
+int main() {
+	bool passed = checkSwap();
+	passed = checkRotation() && passed;
+	if (!passed) {
+		return 1;
+	}
+	std::cout << "Every world check passed\n";
+	return 0;
+}